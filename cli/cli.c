@@ -30,6 +30,7 @@ DEALINGS IN THE SOFTWARE.
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include "shared.h"
 #include "settings.h"
 
@@ -121,18 +122,24 @@ static uint32_t cli_importer(
     
     uint32_t byteLen;
     uint8_t * bytes;
+    matteString_t * path = matte_string_create_from_c_str("%s", name);
     if (import_namespace && strstr(name, matte_string_get_c_str(import_namespace)) == name) {
         // remove namespace
-        matteString_t * str = matte_string_create_from_c_str("%s", name);
-        matte_string_remove_n_chars(str, 0, matte_string_get_length(import_namespace));
-        
-        bytes = (uint8_t*)dump_bytes(matte_string_get_c_str(str), &byteLen, 0);
-        matte_string_destroy(str);
-    } else {
-        // dump bytes
-        bytes = (uint8_t*)dump_bytes(name, &byteLen, 0);
+        matte_string_remove_n_chars(path, 0, matte_string_get_length(import_namespace));
+    }
+
+    // cached bytecode for an unchanged source file
+    int cached = 0;
+    if (!DEBUG) {
+        bytes = matte_bytecode_cache_get(m, matte_string_get_c_str(path), NULL, 0, &byteLen);
+        cached = bytes != NULL;
     }
+    
+    // dump bytes
+    if (!cached)
+        bytes = (uint8_t*)dump_bytes(matte_string_get_c_str(path), &byteLen, 0);
     if (byteLen == 0 || bytes == NULL) {
+        matte_string_destroy(path);
         return 0;
     }
         
@@ -149,32 +156,27 @@ static uint32_t cli_importer(
         bytes[3] == 0x01 &&
         bytes[4] == 0x06 &&
         bytes[5] == 'B') {
-        
-        
-        matteArray_t * stubs = matte_bytecode_stubs_from_bytecode(
-            matte_vm_get_store(matte_get_vm(m)),
-            fileid,
-            bytes,
-            byteLen
-        );
-        if (stubs) {
-            matte_vm_add_stubs(matte_get_vm(m), stubs);
-        } else {
-            fileid = 0; // failed.
-            //matte_print(m, "Failed to assemble bytecode %s.", name); 
-        }        
+        // decoded when first run.
+        matte_vm_add_bytecode(matte_get_vm(m), fileid, bytes, byteLen);
     // raw source
     } else {
         char * source = (char*)matte_allocate(byteLen+1);
         memcpy(source, bytes, byteLen);
-        uint32_t bytecodeLen;
+        uint32_t bytecodeLen = 0;
         matteString_t * error = matte_string_create_from_c_str("");
-        uint8_t * bytecode = matte_compile_source(
-            m,
-            &bytecodeLen,
-            source,
-            error
-        );
+        uint8_t * bytecode = NULL;
+        if (!DEBUG)
+            bytecode = matte_bytecode_cache_get(m, matte_string_get_c_str(path), bytes, byteLen, &bytecodeLen);
+        if (!bytecode) {
+            bytecode = matte_compile_source(
+                m,
+                &bytecodeLen,
+                source,
+                error
+            );
+            if (bytecode && bytecodeLen && !DEBUG)
+                matte_bytecode_cache_put(m, matte_string_get_c_str(path), bytes, byteLen, bytecode, bytecodeLen);
+        }
         if (DEBUG)
             matte_debugging_register_source(m, fileid, source);
             
@@ -206,6 +208,7 @@ static uint32_t cli_importer(
     }
 
     matte_deallocate(bytes);
+    matte_string_destroy(path);
     return fileid;
 }
 
@@ -271,6 +274,12 @@ static void show_help() {
     printf("  -v\n");
     printf("    - Displays this help text.\n\n");
 
+    printf("  --shared-strings [...]\n");
+    printf("    - Given before any of the other options, strings loaded\n");
+    printf("      from bytecode are kept in one table shared by every VM\n");
+    printf("      in the process, including async workers, instead of\n");
+    printf("      each VM interning its own copy.\n\n");
+
     printf("  [file] [args...]\n");
     printf("    - When given a file, Matte will run the file\n");
     printf("      by first importing it and then running the\n");
@@ -287,10 +296,28 @@ static void show_help() {
     printf("    - Assuming each file is a Matte source file, a token analysis is\n");
     printf("      run on each file and printed to stdout.\n\n");
 
+    printf("  opcode-pairs [--raw] [files]\n");
+    printf("    - Runs each file and reports the most frequently executed\n");
+    printf("      pairs of opcodes. With --raw, compiler optimizations,\n");
+    printf("      superinstructions and register-form instructions are\n");
+    printf("      disabled for the given files.\n\n");
+
+    printf("  compile-bench [--rounds N] [files]\n");
+    printf("    - Compiles each file N times (20 by default) and reports\n");
+    printf("      the time spent, the number of allocations and the peak\n");
+    printf("      memory used by the compiler. For example:\n");
+    printf("      matte compile-bench ../testing/*.mt\n\n");
+
     printf("  compile input-source.file output.file\n");
     printf("    - Takes the given file and compiles it into a single bytecode\n");
     printf("      blob. The fileID of the given number is used\n\n");
 
+    printf("environment:\n\n");
+    printf("  MATTE_BYTECODE_CACHE\n");
+    printf("    - When set to an existing directory, bytecode compiled from\n");
+    printf("      imported source files is kept there and reused by later\n");
+    printf("      runs as long as the source is unchanged.\n\n");
+
 
 }
 
@@ -402,7 +429,122 @@ static int packager(matte_t * m, int argc, char ** args) {
 
 
 
+
+// Allocation tracking for compile-bench. Each allocation 
+// is prefixed with its size so the live total can be kept.
+#define COMPILE_BENCH_HEADER 16
+static uint64_t compile_bench_live = 0;
+static uint64_t compile_bench_peak = 0;
+static uint64_t compile_bench_count = 0;
+
+static void * compile_bench_allocate(uint64_t size) {
+    uint8_t * data = (uint8_t*)malloc(size + COMPILE_BENCH_HEADER);
+    if (!data) return NULL;
+    memcpy(data, &size, sizeof(uint64_t));
+    compile_bench_count++;
+    compile_bench_live += size;
+    if (compile_bench_live > compile_bench_peak)
+        compile_bench_peak = compile_bench_live;
+    return data + COMPILE_BENCH_HEADER;
+}
+
+static void compile_bench_deallocate(void * data) {
+    uint8_t * real = ((uint8_t*)data) - COMPILE_BENCH_HEADER;
+    uint64_t size;
+    memcpy(&size, real, sizeof(uint64_t));
+    compile_bench_live -= size;
+    free(real);
+}
+
+// Compiles each file repeatedly and reports timing and memory use 
+// of the compiler alone.
+static int compile_bench(int argc, char ** args) {
+    int first = 2;
+    int rounds = 20;
+    if (argc > 3 && !strcmp(args[2], "--rounds")) {
+        rounds = atoi(args[3]);
+        if (rounds < 1) rounds = 1;
+        first = 4;
+    }
+    if (argc <= first) {
+        printf("Insufficient arguments for compile-bench tool\n");
+        exit(1);
+    }
+
+    // must be set before anything is allocated.
+    matte_set_allocator(compile_bench_allocate, compile_bench_deallocate);
+    uint64_t baseline = compile_bench_live;
+    matte_t * m = matte_create();
+
+    int i, n;
+    uint64_t sourceBytes = 0;
+    uint64_t bytecodeBytes = 0;
+    uint64_t peak = 0;
+    uint64_t count = 0;
+    int failed = 0;
+    double seconds = 0;
+    for(i = first; i < argc; ++i) {
+        uint32_t len;
+        uint8_t * dump = (uint8_t*)dump_bytes(args[i], &len, 1);
+        if (!dump) {
+            printf("Could not open input file %s\n", args[i]);
+            exit(1);
+        }
+        char * src = (char*)matte_allocate(len+1);
+        memcpy(src, dump, len);
+        matte_deallocate(dump);
+        sourceBytes += len;
+        
+        for(n = 0; n < rounds; ++n) {
+            uint64_t startCount = compile_bench_count;
+            compile_bench_peak = compile_bench_live;
+            uint64_t start = compile_bench_live;
+
+            clock_t c = clock();
+            uint32_t size = 0;
+            uint8_t * bytes = matte_compile_source(m, &size, src, NULL);
+            seconds += (clock() - c) / (double)CLOCKS_PER_SEC;
+
+            if (compile_bench_peak - start > peak)
+                peak = compile_bench_peak - start;
+            count += compile_bench_count - startCount;
+            if (!bytes) {
+                if (n == 0) failed++;
+                continue;
+            }
+            if (n == 0) bytecodeBytes += size;
+            matte_deallocate(bytes);
+        }
+        matte_deallocate(src);
+    }
+    int files = argc - first;
+    printf("files:            %d (%d with errors)\n", files, failed);
+    printf("rounds:           %d\n", rounds);
+    printf("source bytes:     %llu\n", (unsigned long long)sourceBytes);
+    printf("bytecode bytes:   %llu\n", (unsigned long long)bytecodeBytes);
+    printf("total time:       %.3f ms\n", seconds * 1000.0);
+    printf("time per round:   %.3f ms\n", seconds * 1000.0 / rounds);
+    printf("allocations:      %llu per round\n", (unsigned long long)(count / rounds));
+    printf("peak memory:      %llu bytes (largest single file)\n", (unsigned long long)peak);
+    matte_destroy(m);
+    if (compile_bench_live != baseline)
+        printf("unreleased:       %lld bytes\n", (long long)(compile_bench_live - baseline));
+    return 0;
+}
+
+
 int main(int argc, char ** args) {
+    // async workers load the same bytecode as their parent, 
+    // so they can share its strings when asked to.
+    if (argc > 1 && !strcmp(args[1], "--shared-strings")) {
+        matte_enable_shared_strings();
+        args++;
+        argc--;
+    }
+
+    if (argc > 1 && !strcmp(args[1], "compile-bench"))
+        return compile_bench(argc, args);
+
     if (argc == 1) {
         return repl();
     }
@@ -413,6 +555,7 @@ int main(int argc, char ** args) {
     matte_t * m = matte_create();
     matte_set_io(m, NULL, NULL, NULL); // standard IO is fine
     matte_set_importer(m, cli_importer, NULL); // standard file import is fine
+    matte_set_bytecode_cache(m, getenv("MATTE_BYTECODE_CACHE"));
     
     if (!strcmp(tool, "package")) {
         return packager(m, argc, args);
@@ -467,6 +610,28 @@ int main(int argc, char ** args) {
                 matte_string_destroy(str);
             }
         }
+    } else if (!strcmp(tool, "opcode-pairs")) {
+        int first = 2;
+        if (argc > 2 && !strcmp(args[2], "--raw")) {
+            matte_compiler_enable_optimization(0);
+            matte_compiler_enable_register_form(0);
+            first = 3;
+        }
+        if (argc <= first) {
+            printf("Insufficient arguments for opcode-pairs tool\n");
+            exit(1);
+        }
+        matteVM_t * vm = matte_get_vm(m);
+        matte_vm_enable_opcode_profile(vm, 1);
+        int i;
+        for(i = first; i < argc; ++i) {
+            matteValue_t v = matte_vm_import(vm, MATTE_VM_STR_CAST(vm, args[i]), NULL, 0, matte_store_new_value(matte_vm_get_store(vm)));
+            matte_store_recycle(matte_vm_get_store(vm), v);
+        }
+        matteString_t * report = matte_vm_opcode_profile_report(vm, 40);
+        printf("%s", matte_string_get_c_str(report));
+        matte_string_destroy(report);
+        matte_destroy(m);
     } else if (!strcmp(tool, "compile")) {
         if (argc != 4) {
             printf("Insufficient arguments for compile tool\n");
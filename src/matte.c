@@ -36,11 +36,13 @@ DEALINGS IN THE SOFTWARE.
 #include "matte_compiler__syntax_graph.h"
 #include "matte_bytecode_stub.h"
 #include "matte_store.h"
+#include "matte_store_string.h"
 #include <stdlib.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
 #include <ctype.h>
+#include <time.h>
 
 typedef struct {
     uint32_t fileid;
@@ -129,6 +131,9 @@ struct matte_t {
     
     // package name string -> mattePackageInfo_t *
     matteTable_t * packages;
+    
+    // directory for cached bytecode of imports, or NULL.
+    char * bytecodeCache;
 };
 
 
@@ -509,6 +514,175 @@ static uint32_t matte_importer(
     return m->importer(m, matte_string_get_c_str(name), alias ? matte_string_get_c_str(alias) : NULL, m->importerData);
 }
 
+int matte_os_get_file_info(const char * path, uint64_t * size, uint64_t * modified);
+
+// 64-bit FNV-1a
+static uint64_t bytecode_cache_hash(const uint8_t * data, uint32_t len) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    uint32_t i;
+    for(i = 0; i < len; ++i) {
+        hash ^= data[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+// Entries are named after the hash of the path they were compiled from.
+static matteString_t * bytecode_cache_entry_path(matte_t * m, const char * path) {
+    uint64_t hash = bytecode_cache_hash((const uint8_t*)path, strlen(path));
+    return matte_string_create_from_c_str(
+        "%s/%08x%08x.mtc", 
+        m->bytecodeCache, 
+        (uint32_t)(hash >> 32), 
+        (uint32_t)hash
+    );
+}
+
+// Layout of a cache entry, followed by the path and the bytecode.
+typedef struct {
+    uint8_t  tag[4];
+    uint32_t compilerVersion;
+    uint64_t sourceSize;
+    uint64_t sourceModified;
+    uint64_t sourceHash;
+    uint32_t pathLength;
+    uint32_t bytecodeSize;
+} matteBytecodeCacheHeader_t;
+
+static const uint8_t BYTECODE_CACHE_TAG[4] = {'M', 'A', 'T', 'C'};
+
+
+void matte_set_bytecode_cache(matte_t * m, const char * directory) {
+    if (m->bytecodeCache)
+        matte_deallocate(m->bytecodeCache);
+    m->bytecodeCache = directory ? matte_strdup(directory) : NULL;
+}
+
+uint8_t * matte_bytecode_cache_get(
+    matte_t * m, 
+    const char * path, 
+    const uint8_t * source,
+    uint32_t sourceLength,
+    uint32_t * bytecodeSize
+) {
+    *bytecodeSize = 0;
+    if (!m->bytecodeCache) return NULL;
+    
+    uint64_t size = 0, modified = 0;
+    if (!matte_os_get_file_info(path, &size, &modified) && !source) return NULL;
+    
+    matteString_t * entryPath = bytecode_cache_entry_path(m, path);
+    FILE * f = fopen(matte_string_get_c_str(entryPath), "rb");
+    matte_string_destroy(entryPath);
+    if (!f) return NULL;
+    
+    matteBytecodeCacheHeader_t header;
+    uint32_t pathLength = strlen(path);
+    if (fread(&header, sizeof(header), 1, f) != 1 ||
+        memcmp(header.tag, BYTECODE_CACHE_TAG, 4) ||
+        header.compilerVersion != matte_compiler_get_version() ||
+        header.pathLength != pathLength) {
+        fclose(f);
+        return NULL;
+    }
+
+    // the same file unchanged, or the same contents
+    int fresh = header.sourceSize == size && header.sourceModified == modified;
+    if (!fresh && (!source || 
+                   header.sourceSize != sourceLength || 
+                   header.sourceHash != bytecode_cache_hash(source, sourceLength))) {
+        fclose(f);
+        return NULL;
+    }
+    
+    char * entryName = (char*)matte_allocate(pathLength+1);
+    uint8_t * bytecode = (uint8_t*)matte_allocate(header.bytecodeSize);
+    if (fread(entryName, 1, pathLength, f) != pathLength ||
+        strcmp(entryName, path) ||
+        fread(bytecode, 1, header.bytecodeSize, f) != header.bytecodeSize) {
+        matte_deallocate(entryName);
+        matte_deallocate(bytecode);
+        fclose(f);
+        return NULL;
+    }
+    matte_deallocate(entryName);
+    fclose(f);
+    
+    // contents match but the file was touched: update the entry
+    // so the next lookup does not need to read the source.
+    if (!fresh)
+        matte_bytecode_cache_put(m, path, source, sourceLength, bytecode, header.bytecodeSize);
+    
+    *bytecodeSize = header.bytecodeSize;
+    return bytecode;
+}
+
+void matte_bytecode_cache_put(
+    matte_t * m, 
+    const char * path, 
+    const uint8_t * source,
+    uint32_t sourceLength,
+    const uint8_t * bytecode,
+    uint32_t bytecodeSize
+) {
+    if (!m->bytecodeCache) return;
+
+    uint64_t size = 0, modified = 0;
+    if (!matte_os_get_file_info(path, &size, &modified)) return;
+    // the file changed while it was being read.
+    if (size != sourceLength) return;
+    // modification times are coarse: a file changed just now 
+    // could change again without its time changing, so only 
+    // its hash can be trusted.
+    if (modified + 2 >= (uint64_t)time(NULL))
+        modified = 0;
+
+    matteBytecodeCacheHeader_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.tag, BYTECODE_CACHE_TAG, 4);
+    header.compilerVersion = matte_compiler_get_version();
+    header.sourceSize = size;
+    header.sourceModified = modified;
+    header.sourceHash = bytecode_cache_hash(source, sourceLength);
+    header.pathLength = strlen(path);
+    header.bytecodeSize = bytecodeSize;
+    
+
+    // written under a temporary name first so that other 
+    // processes never see a partial entry.
+    matteString_t * entryPath = bytecode_cache_entry_path(m, path);
+    matteString_t * tempPath = matte_string_create_from_c_str("%s.%p.tmp", matte_string_get_c_str(entryPath), (void*)m);
+    FILE * f = fopen(matte_string_get_c_str(tempPath), "wb");
+    if (f) {
+        int ok = 
+            fwrite(&header, sizeof(header), 1, f) == 1 &&
+            fwrite(path, 1, header.pathLength, f) == header.pathLength &&
+            fwrite(bytecode, 1, bytecodeSize, f) == bytecodeSize;
+        ok = (fclose(f) == 0) && ok;
+        
+        if (!ok) {
+            remove(matte_string_get_c_str(tempPath));
+        } else {
+            remove(matte_string_get_c_str(entryPath));
+            if (rename(matte_string_get_c_str(tempPath), matte_string_get_c_str(entryPath)) != 0)
+                remove(matte_string_get_c_str(tempPath));
+        }
+    }
+    matte_string_destroy(tempPath);
+    matte_string_destroy(entryPath);
+}
+
+
+static int bytes_are_bytecode(const uint8_t * bytes, uint32_t len) {
+    return len >= 6 &&
+        bytes[0] == 'M'  &&
+        bytes[1] == 'A'  &&
+        bytes[2] == 'T'  &&
+        bytes[3] == 0x01 &&
+        bytes[4] == 0x06 &&
+        bytes[5] == 'B';
+}
+
 static uint32_t default_importer(
     matte_t * m,
     const char * name,
@@ -519,6 +693,18 @@ static uint32_t default_importer(
     // first check if we're dealing with a package.
 
     
+    // cached bytecode for an unchanged source file
+    int useCache = m->bytecodeCache && !m->isDebug;
+    if (useCache) {
+        uint32_t bytecodeSize;
+        uint8_t * bytecode = matte_bytecode_cache_get(m, name, NULL, 0, &bytecodeSize);
+        if (bytecode) {
+            uint32_t fileID = matte_add_module(m, alias ? alias : name, bytecode, bytecodeSize);
+            matte_deallocate(bytecode);
+            return fileID;
+        }
+    }
+    
     // dump bytes
     FILE * f = fopen(name, "rb");
     if (!f) {
@@ -541,6 +727,32 @@ static uint32_t default_importer(
         iter += chunkSize;
     }
     fclose(f);
+    
+    if (useCache && !bytes_are_bytecode(bytes, bytelen)) {
+        uint32_t bytecodeSize = 0;
+        uint8_t * bytecode = matte_bytecode_cache_get(m, name, bytes, bytelen, &bytecodeSize);
+        if (!bytecode) {
+            bytecode = matte_compiler_run(
+                m->graph,
+                bytes,
+                bytelen,
+                &bytecodeSize,
+                default_compile_error,
+                m
+            );
+            if (bytecode && bytecodeSize)
+                matte_bytecode_cache_put(m, name, bytes, bytelen, bytecode, bytecodeSize);
+        }
+
+        // on failure, the source is given as-is to report the error.
+        if (bytecode && bytecodeSize) {
+            matte_deallocate(bytes);
+            bytes = bytecode;
+            bytelen = bytecodeSize;
+        } else if (bytecode) {
+            matte_deallocate(bytecode);
+        }
+    }
 
     uint32_t fileID = matte_add_module(
         m,
@@ -572,6 +784,8 @@ matteVM_t * matte_get_vm(matte_t * m) {
 void matte_destroy(matte_t * m) {
     matte_vm_destroy(m->vm);
     matte_syntax_graph_destroy(m->graph);
+    if (m->bytecodeCache)
+        matte_deallocate(m->bytecodeCache);
     matte_deallocate(m);
 }
 
@@ -602,6 +816,10 @@ void matte_set_io(
     matte_vm_set_unhandled_callback(m->vm, default_unhandled_error, m);
 }
 
+void matte_set_random_seed(matte_t * m, uint64_t seed) {
+    matte_vm_set_random_seed(m->vm, seed);
+}
+
 
 
 
@@ -821,29 +1039,9 @@ uint32_t matte_add_module(
     uint32_t fileid = matte_vm_get_new_file_id(m->vm, MATTE_VM_STR_CAST(m->vm, name));   
     // determine if bytecode or raw source.
     // handle bytecodecase
-    if (bytelen >= 6 &&
-        bytes[0] == 'M'  &&
-        bytes[1] == 'A'  &&
-        bytes[2] == 'T'  &&
-        bytes[3] == 0x01 &&
-        bytes[4] == 0x06 &&
-        bytes[5] == 'B') {
-        
-        
-        matteArray_t * stubs = matte_bytecode_stubs_from_bytecode(
-            matte_vm_get_store(m->vm),
-            fileid,
-            bytes,
-            bytelen
-        );
-        if (stubs) {
-            matte_vm_add_stubs(m->vm, stubs);
-        } else {
-            fileid = 0; // failed.
-            matteString_t * str = matte_string_create_from_c_str("Failed to assemble bytecode %s.", name);
-            matte_vm_raise_error_string(m->vm, str);
-            matte_string_destroy(str);
-        }        
+    if (bytes_are_bytecode(bytes, bytelen)) {
+        // decoded when first imported.
+        matte_vm_add_bytecode(m->vm, fileid, bytes, bytelen);
     // raw source
     } else {
         uint32_t bytecodeLen;
@@ -949,6 +1147,10 @@ void matte_set_allocator(
     matte_deallocate_fn = deallocator;
 }
 
+void matte_enable_shared_strings() {
+    matte_string_store_enable_shared();
+}
+
 matteSyntaxGraph_t * matte_get_syntax_graph(matte_t * m) {
     return m->graph;
 }
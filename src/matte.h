@@ -67,6 +67,19 @@ void matte_set_allocator(
 );
 
 
+/// Enables a process-wide table of strings shared by all 
+/// Matte instances. Strings loaded from bytecode, such as 
+/// names and string constants, are then kept once for the 
+/// whole process instead of once per VM, which reduces the 
+/// memory and startup time of each additional VM, such 
+/// as async workers. Lookups within the table are lock-free.
+///
+/// Once enabled, the table cannot be disabled and its strings 
+/// are kept until the process exits.
+///
+void matte_enable_shared_strings();
+
+
 /// Destroys a Matte instance and all owned components.
 ///
 void matte_destroy(
@@ -107,6 +120,17 @@ void matte_set_io(
     void   (*clear)(matte_t *)
 );  
 
+/// Seeds the random number generator of the instance's VM, 
+/// which backs Number.random. Runs with the same seed draw 
+/// the same numbers. Scripts can also seed it with Number.seed.
+void matte_set_random_seed(
+    /// The matte instance
+    matte_t *,
+    
+    /// The seed.
+    uint64_t seed
+);
+
 
 
 /// When called, enables debugging features with default handlers
@@ -303,6 +327,73 @@ void matte_set_importer(
 );
 
 
+/// Sets a directory in which compiled bytecode of imported 
+/// source files is kept between runs. When set, importing 
+/// a source file first looks for an entry in the cache 
+/// made from the same path, file size and modification time 
+/// by the same compiler version; if the size or time differ, 
+/// the entry is still used when a hash of the source matches. 
+/// Otherwise the source is compiled and the result is stored.
+/// The directory must already exist. Entries are keyed by the 
+/// path as given to the importer. Passing NULL disables the 
+/// cache, which is the default. The cache is not used while 
+/// debugging, as the debugger needs the source.
+void matte_set_bytecode_cache(
+    /// The matte instance
+    matte_t *,
+    
+    /// The directory to store bytecode in, or NULL.
+    const char * directory
+);
+
+/// Returns bytecode from the bytecode cache for the source 
+/// file at the given path, or NULL if there is no usable entry 
+/// or no cache is set. If source is NULL, the entry is only 
+/// checked against the file's size and modification time, 
+/// so the file does not need to be read.
+/// The returned bytecode must be freed with matte_deallocate().
+/// This is mostly useful for custom importers.
+uint8_t * matte_bytecode_cache_get(
+    /// The matte instance
+    matte_t *,
+    
+    /// Path to the source file.
+    const char * path,
+    
+    /// The contents of the source file, or NULL.
+    const uint8_t * source,
+    
+    /// The length of the source in bytes.
+    uint32_t sourceLength,
+    
+    /// Set to the size of the returned bytecode.
+    uint32_t * bytecodeSize
+);
+
+/// Stores bytecode compiled from the source file at the 
+/// given path in the bytecode cache. Does nothing if no 
+/// cache is set. Failing to write the entry is not an error.
+void matte_bytecode_cache_put(
+    /// The matte instance
+    matte_t *,
+    
+    /// Path to the source file.
+    const char * path,
+    
+    /// The contents of the source file.
+    const uint8_t * source,
+    
+    /// The length of the source in bytes.
+    uint32_t sourceLength,
+    
+    /// The bytecode compiled from the source.
+    const uint8_t * bytecode,
+    
+    /// The size of the bytecode in bytes.
+    uint32_t bytecodeSize
+);
+
+
 /// Loads a package file and preloads all its 
 /// sources. Any trailing packages are also loaded.
 /// If any of the embedded packages fail to be 
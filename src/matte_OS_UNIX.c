@@ -6,6 +6,8 @@
 
 #if (unix || __unix || __unix__)
 #include <sys/time.h>
+#include <sys/stat.h>
+#include <stdint.h>
 #include <stddef.h>
 double matte_os_get_ticks() {
     struct timeval t; 
@@ -14,4 +16,16 @@ double matte_os_get_ticks() {
 }
     
     
+
+// Gets the size and last modification time of a file.
+// Returns 0 if the file could not be accessed.
+int matte_os_get_file_info(const char * path, uint64_t * size, uint64_t * modified) {
+    struct stat info;
+    if (stat(path, &info) != 0) return 0;
+    *size = (uint64_t)info.st_size;
+    *modified = (uint64_t)info.st_mtime;
+    return 1;
+}
+
+
 #endif
@@ -7,6 +7,8 @@
 
 
 #include <windows.h>
+#include <sys/stat.h>
+#include <stdint.h>
 double matte_os_get_ticks() {
     LARGE_INTEGER freq = {};
     QueryPerformanceFrequency(&freq);
@@ -15,6 +17,15 @@ double matte_os_get_ticks() {
     return (ticks.QuadPart * (1.0 / (freq.QuadPart))) * 1000.0;
 }
 
+// Gets the size and last modification time of a file.
+// Returns 0 if the file could not be accessed.
+int matte_os_get_file_info(const char * path, uint64_t * size, uint64_t * modified) {
+    struct stat info;
+    if (stat(path, &info) != 0) return 0;
+    *size = (uint64_t)info.st_size;
+    *modified = (uint64_t)info.st_mtime;
+    return 1;
+}
 
 
 #endif
@@ -41,8 +41,33 @@ DEALINGS IN THE SOFTWARE.
 
 static float get_resize(uint32_t size) {
     if (size < 10) return 2;
-    if (size < 1000) return 1.3;
-    return 1.1;    
+    return 1.5;
+}
+
+// Moves the array into a new allocation of exactly allocSize elements.
+static void array_realloc(matteArray_t * t, uint32_t allocSize) {
+    uint8_t * newData = (uint8_t*)matte_allocate(allocSize*t->sizeofType);
+    memcpy(newData, t->data, t->allocSize*t->sizeofType);
+    matte_deallocate(t->data);
+    t->data = newData;
+    t->allocSize = allocSize;
+}
+
+// Grows the allocation geometrically until it holds at least 
+// count elements. Only one reallocation happens regardless 
+// of how far the array grows.
+static void array_grow(matteArray_t * t, uint32_t count) {
+    uint32_t alloc = t->allocSize;
+    while(alloc < count) {
+        uint32_t next = alloc*get_resize(alloc)+1;
+        // overflow: settle for the exact amount.
+        if (next <= alloc) {
+            alloc = count;
+            break;
+        }
+        alloc = next;
+    }
+    array_realloc(t, alloc);
 }
 
 #define array_presize_amt 1
@@ -135,14 +160,8 @@ void matte_array_push_n(matteArray_t * t, const void * elements, uint32_t count)
     #ifdef MATTE_DEBUG
         assert(t && "matteArray_t pointer cannot be NULL.");
     #endif
-    while(t->size + count > t->allocSize) {
-        uint32_t oldSize = t->allocSize*t->sizeofType;
-        t->allocSize = t->allocSize*get_resize(t->allocSize)+1;
-        uint8_t * newData = (uint8_t*)matte_allocate(t->allocSize*t->sizeofType);
-        memcpy(newData, t->data, oldSize);
-        matte_deallocate(t->data);
-        t->data = newData;
-    }
+    if (t->size + count > t->allocSize)
+        array_grow(t, t->size + count);
     memcpy(
         (t->data)+(t->size*t->sizeofType), 
         elements, 
@@ -192,13 +211,15 @@ void matte_array_set_size(matteArray_t * t, uint32_t size) {
     #ifdef MATTE_DEBUG
         assert(t && "matteArray_t pointer cannot be NULL.");
     #endif
-    while(size >= t->allocSize) {
-        uint32_t oldSize = t->allocSize*t->sizeofType;
-        t->allocSize = t->allocSize*get_resize(t->allocSize)+1;
-        uint8_t * newData = (uint8_t*)matte_allocate(t->allocSize*t->sizeofType);
-        memcpy(newData, t->data, oldSize);
-        matte_deallocate(t->data);
-        t->data = newData;
-    }
+    if (size >= t->allocSize)
+        array_grow(t, size+1);
     t->size = size;
 }
+
+void matte_array_reserve(matteArray_t * t, uint32_t count) {
+    #ifdef MATTE_DEBUG
+        assert(t && "matteArray_t pointer cannot be NULL.");
+    #endif
+    if (count > t->allocSize)
+        array_realloc(t, count);
+}
@@ -225,6 +225,17 @@ void matte_array_set_size(
     uint32_t size
 );
 
+/// Makes sure the array can hold at least count elements 
+/// without reallocating. The size of the array is unchanged.
+///
+void matte_array_reserve(
+    /// The array to modify.
+    matteArray_t * array,
+
+    /// The number of elements to make room for.
+    uint32_t count
+);
+
 struct matteArray_t {
     uint32_t allocSize;
     uint32_t size;
@@ -62,6 +62,8 @@ struct matteBytecodeStub_t {
     uint32_t startingLine;
     int isDynamicBinding;
     uint8_t isVarArg;
+    // whether any nested function captures the args or locals.
+    uint8_t referrablesCaptured;
 
 };  
 
@@ -90,7 +92,7 @@ static matteValue_t chomp_string(matteStore_t * store, uint8_t ** bytes, uint32_
     matte_deallocate(utf8raw);
 
     matteValue_t v = matte_store_new_value(store);
-    matte_value_into_string(store, &v, str);
+    matte_value_into_string_shared(store, &v, str);
     matte_string_destroy(str);
     return v;
 }
@@ -98,6 +100,7 @@ static matteValue_t chomp_string(matteStore_t * store, uint8_t ** bytes, uint32_
 matteBytecodeStub_t * matte_bytecode_stub_create_symbolic() {
     matteBytecodeStub_t * out = (matteBytecodeStub_t*)matte_allocate(sizeof(matteBytecodeStub_t));
     out->isDynamicBinding = 1;
+    out->referrablesCaptured = 1;
     return out;
 }
 
@@ -121,7 +124,8 @@ static matteBytecodeStub_t * bytes_to_stub(matteStore_t * store, uint32_t fileID
         return out;
     }
     ADVANCE(uint8_t, ver);
-    if (ver != 1) return out;
+    // version 2 adds stub flags and register-form instructions.
+    if (ver != 1 && ver != 2) return out;
 
     matteValue_t dynamicBindTokenVal = matte_store_get_dynamic_bind_token_noref(store);
 
@@ -129,6 +133,14 @@ static matteBytecodeStub_t * bytes_to_stub(matteStore_t * store, uint32_t fileID
     out->fileID = fileID;
     ADVANCE(uint32_t, out->stubID);
     ADVANCE(uint8_t, out->isVarArg);
+    if (ver == 1) {
+        // no way to know; assume the worst.
+        out->referrablesCaptured = 1;
+    } else {
+        // version 2 packs flags into this byte.
+        out->referrablesCaptured = (out->isVarArg & 2) != 0;
+        out->isVarArg &= 1;
+    }
     ADVANCE(uint8_t, out->argCount);
     out->argNames = (matteValue_t*)matte_allocate(sizeof(matteValue_t)*out->argCount);
     for(i = 0; i < out->argCount; ++i) {
@@ -173,6 +185,177 @@ static matteBytecodeStub_t * bytes_to_stub(matteStore_t * store, uint32_t fileID
     return out;    
 }
 
+// Unsigned LEB128. Stops at the end of the input.
+static uint64_t chomp_varuint(uint8_t ** bytes, uint32_t * left) {
+    uint64_t v = 0;
+    int shift = 0;
+    while(*left) {
+        uint8_t b = **bytes;
+        (*bytes)++;
+        (*left)--;
+        if (shift < 64)
+            v |= ((uint64_t)(b & 0x7f)) << shift;
+        shift += 7;
+        if (!(b & 0x80)) break;
+    }
+    return v;
+}
+
+static matteValue_t pool_string(const matteValue_t * pool, uint32_t poolCount, uint64_t index) {
+    if (index >= poolCount) {
+        matteValue_t v = {};
+        return v;
+    }
+    return pool[index];
+}
+
+// Reads one stub of an indexed container. Names and strings 
+// come from the already-read pool.
+static matteBytecodeStub_t * indexed_bytes_to_stub(
+    matteStore_t * store, 
+    uint32_t fileID, 
+    uint32_t stubID,
+    const matteValue_t * pool,
+    uint32_t poolCount,
+    uint8_t ** bytes, 
+    uint32_t * left
+) {
+    matteBytecodeStub_t * out = (matteBytecodeStub_t*)matte_allocate(sizeof(matteBytecodeStub_t));
+    matteValue_t dynamicBindTokenVal = matte_store_get_dynamic_bind_token_noref(store);
+    uint32_t i;
+    out->fileID = fileID;
+    out->stubID = stubID;
+    
+    uint32_t flags = chomp_varuint(bytes, left);
+    out->isVarArg = (flags & 1) != 0;
+    out->referrablesCaptured = (flags & 2) != 0;
+
+    out->argCount = chomp_varuint(bytes, left);
+    out->argNames = (matteValue_t*)matte_allocate(sizeof(matteValue_t)*out->argCount);
+    for(i = 0; i < out->argCount; ++i) {
+        out->argNames[i] = pool_string(pool, poolCount, chomp_varuint(bytes, left)); 
+        if (out->argNames[i].value.id == dynamicBindTokenVal.value.id) {
+            out->isDynamicBinding = 1;
+        }
+    }        
+
+    out->localCount = chomp_varuint(bytes, left);
+    out->localNames = (matteValue_t*)matte_allocate(sizeof(matteValue_t)*out->localCount);
+    for(i = 0; i < out->localCount; ++i) {
+        out->localNames[i] = pool_string(pool, poolCount, chomp_varuint(bytes, left)); 
+    }        
+
+    out->stringCount = chomp_varuint(bytes, left);
+    if (out->stringCount > *left) out->stringCount = *left;
+    out->strings = (matteValue_t*)matte_allocate(sizeof(matteValue_t)*out->stringCount);
+    for(i = 0; i < out->stringCount; ++i) {
+        out->strings[i] = pool_string(pool, poolCount, chomp_varuint(bytes, left)); 
+    }        
+
+    out->capturedCount = chomp_varuint(bytes, left);
+    if (out->capturedCount) {
+        out->captures = (matteBytecodeStubCapture_t*)matte_allocate(sizeof(matteBytecodeStubCapture_t)* out->capturedCount);
+        for(i = 0; i < out->capturedCount; ++i) {
+            out->captures[i].stubID = chomp_varuint(bytes, left);
+            out->captures[i].referrable = chomp_varuint(bytes, left);
+        }
+    }
+    
+    out->startingLine = chomp_varuint(bytes, left);
+    out->instructionCount = chomp_varuint(bytes, left);
+    if (out->instructionCount > *left) out->instructionCount = *left;
+    if (out->instructionCount) {
+        out->instructions = (matteBytecodeStubInstruction_t*)matte_allocate(sizeof(matteBytecodeStubInstruction_t)* out->instructionCount);    
+        for(i = 0; i < out->instructionCount; ++i) {
+            matteBytecodeStubInstruction_t * inst = out->instructions+i;
+            uint8_t op = 0;
+            ADVANCE(uint8_t, op);
+            inst->info.opcode = op & 63;
+            switch(op >> 6) {
+              case MATTE_BYTECODE_OPERAND__ZERO:
+                break;
+              case MATTE_BYTECODE_OPERAND__INTEGER:
+                inst->data = chomp_varuint(bytes, left);
+                break;
+              case MATTE_BYTECODE_OPERAND__BITS: {
+                uint64_t bits = chomp_varuint(bytes, left);
+                memcpy(&inst->data, &bits, sizeof(uint64_t));
+                break;
+              }
+              case MATTE_BYTECODE_OPERAND__RAW:
+                ADVANCE(double, inst->data);
+                break;
+            }
+            if (inst->info.opcode == MATTE_OPCODE_NFN) {
+                inst->funcData.nfnFileID = fileID;
+            }
+        }
+        
+        // line table
+        i = 0;
+        while(i < out->instructionCount && *left) {
+            uint32_t run = chomp_varuint(bytes, left);
+            uint16_t line = chomp_varuint(bytes, left);
+            while(run-- && i < out->instructionCount) {
+                out->instructions[i++].info.lineOffset = line;
+            }
+        }
+    }
+    return out;
+}
+
+
+// Reads all stubs of an indexed container. Stubs are 
+// located through the index rather than by reading 
+// every stub before them.
+static matteArray_t * indexed_bytes_to_stubs(
+    matteStore_t * store, 
+    uint32_t fileID, 
+    uint8_t * bytecode, 
+    uint32_t len
+) {
+    matteArray_t * arr = matte_array_create(sizeof(matteBytecodeStub_t *));
+    uint8_t * iter = bytecode + 7;
+    uint8_t ** bytes = &iter;
+    uint32_t leftV = len - 7;
+    uint32_t * left = &leftV;
+    uint32_t i;
+    
+    uint32_t stubCount = 0;
+    ADVANCE(uint32_t, stubCount);
+    if (stubCount > leftV / (2*sizeof(uint32_t))) return arr;
+    uint32_t * index = (uint32_t*)matte_allocate(stubCount*2*sizeof(uint32_t));
+    ADVANCEN(stubCount*2*sizeof(uint32_t), index[0]);
+    
+    uint32_t poolCount = chomp_varuint(bytes, left);
+    if (poolCount > leftV) poolCount = leftV;
+    matteValue_t * pool = (matteValue_t*)matte_allocate(sizeof(matteValue_t)*(poolCount+1));
+    for(i = 0; i < poolCount; ++i) {
+        uint32_t strLen = chomp_varuint(bytes, left);
+        if (strLen > leftV) strLen = leftV;
+        uint8_t * utf8raw = (uint8_t*)matte_allocate(strLen+1);
+        ADVANCEN(strLen, utf8raw[0]);
+        matteString_t * str = matte_string_create_from_c_str("%s", utf8raw);
+        matte_deallocate(utf8raw);
+        
+        pool[i] = matte_store_new_value(store);
+        matte_value_into_string_shared(store, pool+i, str);
+        matte_string_destroy(str);
+    }
+    
+    for(i = 0; i < stubCount; ++i) {
+        uint32_t offset = index[i*2+1];
+        if (offset >= len) continue;
+        uint8_t * stubBytes = bytecode + offset;
+        uint32_t stubLeft = len - offset;
+        matteBytecodeStub_t * s = indexed_bytes_to_stub(store, fileID, index[i*2], pool, poolCount, &stubBytes, &stubLeft);
+        matte_array_push(arr, s);
+    }
+    matte_deallocate(pool);
+    matte_deallocate(index);
+    return arr;
+}
+
 void matte_bytecode_stub_destroy(matteBytecodeStub_t * b) {
     matte_deallocate(b->strings);   
     matte_deallocate(b->captures);
@@ -189,6 +372,9 @@ matteArray_t * matte_bytecode_stubs_from_bytecode(
     const uint8_t * bytecodeRaw, 
     uint32_t len
 ) {
+    if (len > 7 && bytecodeRaw[6] == MATTE_BYTECODE_VERSION__INDEXED) 
+        return indexed_bytes_to_stubs(store, fileID, (uint8_t*)bytecodeRaw, len);
+    
     matteArray_t * arr = matte_array_create(sizeof(matteBytecodeStub_t *));
     while(len) {
         matteBytecodeStub_t * s = bytes_to_stub(store, fileID, (uint8_t**)(&bytecodeRaw), &len);
@@ -267,6 +453,10 @@ int matte_bytecode_stub_is_vararg(const matteBytecodeStub_t * stub) {
     return stub->isVarArg;
 }
 
+int matte_bytecode_stub_referrables_captured(const matteBytecodeStub_t * stub) {
+    return stub->referrablesCaptured;
+}
+
 
 int matte_bytecode_stub_is_dynamic_bind(const matteBytecodeStub_t * stub) {
     return stub->isDynamicBinding;
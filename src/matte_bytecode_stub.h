@@ -83,6 +83,41 @@ typedef struct matteString_t matteString_t;
 
 typedef struct matteBytecodeStub_t matteBytecodeStub_t;
 
+
+/// Bytecode starts with the tag 'M', 'A', 'T', 0x01, 0x06, 'B' 
+/// followed by a version byte. Versions 1 and 2 repeat the 
+/// tag for every stub, each with its own names and strings and 
+/// fixed-size instructions. 
+///
+/// The indexed version holds all stubs of a file in one container:
+/// - the tag and version byte
+/// - uint32 stub count, then a uint32 stubID and uint32 byte offset 
+///   from the start of the bytecode for each stub
+/// - the string pool: a count then each string's UTF-8 length 
+///   and bytes. Stubs refer to names and strings by pool index.
+/// - the stubs at their offsets: flags (1: vararg, 2: referrables captured),
+///   argument, local and string pool indices, captures, starting line,
+///   instructions and a line table.
+///
+/// Counts, lengths and indices are unsigned LEB128 unless noted.
+/// Instructions are an opcode byte whose top 2 bits give the operand 
+/// kind, followed by the operand. The line table is a series of 
+/// (instruction count, line offset) runs.
+#define MATTE_BYTECODE_VERSION__INDEXED 3
+
+/// Operand kinds of indexed bytecode instructions
+typedef enum {
+    /// data is all zero bits; nothing follows.
+    MATTE_BYTECODE_OPERAND__ZERO,
+    /// data is a non-negative integer, written as LEB128.
+    MATTE_BYTECODE_OPERAND__INTEGER,
+    /// the bits of data are written as a LEB128 integer.
+    MATTE_BYTECODE_OPERAND__BITS,
+    /// data is written as-is in 8 bytes.
+    MATTE_BYTECODE_OPERAND__RAW
+} matteBytecodeOperandKind_t;
+
+
 /// Creates a symbolic bytecode stub that doesnt do anything 
 /// and accepts all arguments.
 matteBytecodeStub_t * matte_bytecode_stub_create_symbolic();
@@ -143,6 +178,11 @@ matteValue_t matte_bytecode_stub_get_string_noref(const matteBytecodeStub_t *, u
 /// packed within it as an object.
 int matte_bytecode_stub_is_vararg(const matteBytecodeStub_t *);
 
+/// Returns whether any function defined within this one captures 
+/// its arguments or locals. If not, the referrables are never 
+/// needed past the function's own call.
+int matte_bytecode_stub_referrables_captured(const matteBytecodeStub_t *);
+
 
 /// Returns whether the bytecode is dynamically bound, meaning 
 /// an argument is named "$"
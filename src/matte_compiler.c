@@ -39,6 +39,7 @@ DEALINGS IN THE SOFTWARE.
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <math.h>
 
 
 
@@ -54,6 +55,15 @@ DEALINGS IN THE SOFTWARE.
 // on error which result in termination of valid compilation,
 // settings are controlled using statics.
 static int OPTION__NAMED_REFERENCES = 0;
+static int OPTION__OPTIMIZE = 1;
+static int OPTION__REGISTER_FORM = 1;
+
+// Revision of the code generator. Bump whenever the bytecode 
+// produced for the same source changes, so that cached 
+// bytecode from older builds is not reused. Opcode changes 
+// need a bump; ext call additions are covered by 
+// matte_compiler_get_version() on their own.
+#define MATTE_COMPILER_REVISION 3
 
 typedef struct matteToken_t matteToken_t ;
 
@@ -199,6 +209,9 @@ struct matteFunctionBlock_t {
     matteArray_t * local_isConst;
     // array of matteString_t *
     matteArray_t * args;
+    // array of int, of size args. Whether the argument
+    // is declared as a Number.
+    matteArray_t * arg_isNumber;
     // array of static strings.
     matteArray_t * strings;
     // array of matteBytecodeStubInstruction_t
@@ -227,6 +240,24 @@ static void * matte_function_block_array_to_bytecode(
     uint32_t * size
 );
 
+// compiles functions that are called as soon as they are made 
+// directly into the function that makes them.
+static void function_block_array_inline(matteArray_t * arr);
+
+// folds constants and removes unused code within the block.
+static void function_block_optimize(matteFunctionBlock_t * block);
+
+// rewrites statements that only move values between referrables
+// into register-form instructions.
+static void function_block_to_register_form(matteFunctionBlock_t * block);
+
+// marks common opcode sequences with superinstructions.
+static void function_block_fuse(matteFunctionBlock_t * block);
+
+// replaces operators on values known to be numbers with 
+// number-only opcodes.
+static void function_block_specialize_numbers(matteFunctionBlock_t * block);
+
 
 matteString_t * matte_compiler_tokenize(
     matteSyntaxGraph_t * graphsrc,
@@ -248,13 +279,14 @@ matteString_t * matte_compiler_tokenize(
         if (matte_tokenizer_is_end(w)) break;
     }
 
-    matte_tokenizer_destroy(w);
     if (!success) {
         matte_syntax_graph_walker_destroy(st);
+        matte_tokenizer_destroy(w);
         return NULL;
     }
     matteString_t * out = matte_syntax_graph_print(st);
     matte_syntax_graph_walker_destroy(st);
+    matte_tokenizer_destroy(w);
     return out;
 }
 
@@ -279,10 +311,10 @@ static uint8_t * matte_compiler_run_base(
     while((success = matte_syntax_graph_continue(st, MATTE_SYNTAX_CONSTRUCT_FUNCTION_SCOPE_STATEMENT))) {
         if (matte_tokenizer_is_end(w)) break;
     }
-    matte_tokenizer_destroy(w);
     if (!success) {
         *size = 0;
         matte_syntax_graph_walker_destroy(st);
+        matte_tokenizer_destroy(w);
         return NULL;
     }
 
@@ -290,18 +322,36 @@ static uint8_t * matte_compiler_run_base(
     // a majority of compilation errors will likely happen here, 
     // as only a strict series of tokens are allowed in certain 
     // groups. Might want to form function groups with parenting to track referrables.
-    // optimization may happen here if desired.
 
     // finally emit code for groups.
     matteArray_t * arr = matte_syntax_graph_compile(st);
+    // tokens and expression nodes are no longer needed past this point.
+    matte_syntax_graph_walker_destroy(st);
+    matte_tokenizer_destroy(w);
     if (!arr) {
         *size = 0;
-        matte_syntax_graph_walker_destroy(st);
         return NULL;
     }
+    
+    if (OPTION__OPTIMIZE)
+        function_block_array_inline(arr);
+    {
+        uint32_t i;
+        uint32_t len = matte_array_get_size(arr);
+        for(i = 0; i < len; ++i) {
+            matteFunctionBlock_t * block = matte_array_at(arr, matteFunctionBlock_t *, i);
+            if (OPTION__OPTIMIZE)
+                function_block_optimize(block);
+            if (OPTION__REGISTER_FORM)
+                function_block_to_register_form(block);
+            if (OPTION__OPTIMIZE) {
+                function_block_fuse(block);
+                function_block_specialize_numbers(block);
+            }
+        }
+    }
 
     void * bytecode = matte_function_block_array_to_bytecode(arr, size);
-    matte_syntax_graph_walker_destroy(st);
 
 
     // cleanup :(
@@ -323,6 +373,23 @@ uint8_t * matte_compiler_run_with_named_references(
     );
 }
 
+void matte_compiler_enable_optimization(int enabled) {
+    OPTION__OPTIMIZE = enabled;
+}
+
+void matte_compiler_enable_register_form(int enabled) {
+    OPTION__REGISTER_FORM = enabled;
+}
+
+uint32_t matte_compiler_get_version() {
+    // bytecode embeds ext call IDs, so the size of the 
+    // ext call table is part of the version too.
+    return ((uint32_t)MATTE_EXT_CALL_GETEXTERNALFUNCTION << 16) |
+           (MATTE_COMPILER_REVISION << 8) |
+           (OPTION__OPTIMIZE ? 1 : 0) |
+           (OPTION__REGISTER_FORM ? 2 : 0);
+}
+
 uint8_t * matte_compiler_run(
     matteSyntaxGraph_t * graph,
     const uint8_t * source, 
@@ -407,10 +474,11 @@ static int utf8_next_char(uint8_t ** source) {
 }
 
 
-static matteString_t * consume_variable_name(uint8_t ** src) {
+// Reads a variable name into the given string.
+static matteString_t * consume_variable_name(uint8_t ** src, matteString_t * varname) {
     int c = utf8_next_char(src);
 
-    matteString_t * varname = matte_string_create();
+    matte_string_clear(varname);
     // not allowed to start with number
     switch(c) {
         case '0':
@@ -447,22 +515,73 @@ static matteString_t * consume_variable_name(uint8_t ** src) {
 }
 
 
+// Bump allocator for memory that lives as long as a compilation.
+// Memory is handed out in order from large blocks and is only 
+// released all at once.
+#define COMPILER_ARENA_BLOCK_SIZE (16*1024)
+typedef struct {
+    // array of uint8_t *, all blocks so far.
+    matteArray_t * blocks;
+    // next free byte in the current block.
+    uint8_t * iter;
+    // bytes left in the current block.
+    uint32_t left;
+} matteCompilerArena_t;
+
+static void compiler_arena_init(matteCompilerArena_t * a) {
+    a->blocks = matte_array_create(sizeof(uint8_t *));
+    a->iter = NULL;
+    a->left = 0;
+}
+
+// Returns zeroed memory that is valid until the arena is released.
+static void * compiler_arena_allocate(matteCompilerArena_t * a, uint32_t size) {
+    size = (size + 7) & ~7;
+    if (size > a->left) {
+        uint32_t blockSize = size > COMPILER_ARENA_BLOCK_SIZE ? size : COMPILER_ARENA_BLOCK_SIZE;
+        uint8_t * block = (uint8_t*)matte_allocate(blockSize);
+        matte_array_push(a->blocks, block);
+        a->iter = block;
+        a->left = blockSize;
+    }
+    void * out = a->iter;
+    a->iter += size;
+    a->left -= size;
+    return out;
+}
+
+static void compiler_arena_release(matteCompilerArena_t * a) {
+    uint32_t i;
+    uint32_t len = matte_array_get_size(a->blocks);
+    for(i = 0; i < len; ++i) {
+        matte_deallocate(matte_array_at(a->blocks, uint8_t *, i));
+    }
+    matte_array_destroy(a->blocks);
+    a->blocks = NULL;
+}
+
+
 struct matteTokenizer_t {
     uint8_t * backup;
     uint8_t * iter;
     uint8_t * source;
     uint32_t line;
     uint32_t character;
-
+    
+    // holds all tokens and other short-lived compilation data.
+    matteCompilerArena_t arena;
+    // reused for text that might not become a token.
+    matteString_t * scratch;
 };
 
 static matteToken_t * new_token(
+    matteTokenizer_t * tokenizer,
     matteString_t * str,
     uint32_t line, 
     uint32_t character, 
     matteTokenType_t type
 ) {
-    matteToken_t * t = (matteToken_t*)matte_allocate(sizeof(matteToken_t));
+    matteToken_t * t = (matteToken_t*)compiler_arena_allocate(&tokenizer->arena, sizeof(matteToken_t));
     t->line = line;
     t->character = character;
     t->ttype = type;
@@ -485,11 +604,12 @@ void matte_token_new_data(matteToken_t * t, void * data, int dataType) {
 }
 
 
+// Releases the data of a token. The token itself 
+// belongs to the tokenizer's arena.
 static void destroy_token(
     matteToken_t * t
 ) {
     matte_token_new_data(t, NULL, -1);
-    matte_deallocate(t);
 }
 
 
@@ -504,10 +624,14 @@ matteTokenizer_t * matte_tokenizer_create(const uint8_t * data, uint32_t byteCou
     memcpy(t->source+byteCount, &end, sizeof(int32_t));
     t->iter = t->source;
     t->backup = t->iter;
+    t->scratch = matte_string_create();
+    compiler_arena_init(&t->arena);
     return t;
 }
 
 void matte_tokenizer_destroy(matteTokenizer_t * t) {
+    compiler_arena_release(&t->arena);
+    matte_string_destroy(t->scratch);
     matte_deallocate(t->source);
     matte_deallocate(t);
 }
@@ -615,6 +739,7 @@ static matteToken_t * matte_tokenizer_consume_char(
         t->character++;
         t->backup = t->iter;
         return new_token(
+            t,
             matte_string_create_from_c_str("%c", cha),
             line,
             ch,
@@ -655,6 +780,7 @@ static matteToken_t * matte_tokenizer_consume_exact(
     t->backup = t->iter;
 
     return new_token(
+        t,
         matte_string_create_from_c_str("%s", str),
         line,
         ch,
@@ -671,14 +797,13 @@ static matteToken_t * matte_tokenizer_consume_word(
     matteTokenType_t ty,
     const char * word
 ) {
-    matteString_t * str = consume_variable_name(&t->iter);
-    matteString_t * token = matte_string_create_from_c_str(word);
-    if (matte_string_test_eq(str, token)) {
+    matteString_t * str = consume_variable_name(&t->iter, t->scratch);
+    if (!strcmp(matte_string_get_c_str(str), word)) {
         t->character += matte_string_get_length(str);
         t->backup = t->iter;
-        matte_string_destroy(token);
         return new_token(
-            str,
+            t,
+            matte_string_clone(str),
             line,
             ch,
             ty
@@ -687,8 +812,6 @@ static matteToken_t * matte_tokenizer_consume_word(
         t->line = preLine;
         t->character = preCh;
         t->iter = t->backup;        
-        matte_string_destroy(str);
-        matte_string_destroy(token);
         return NULL;
     }
 }
@@ -846,6 +969,7 @@ matteToken_t * matte_tokenizer_next(matteTokenizer_t * t, matteTokenType_t ty) {
             t->backup = t->iter;
 
             return new_token(
+                t,
                 out, //xfer ownership
                 currentLine,
                 currentCh,
@@ -856,6 +980,7 @@ matteToken_t * matte_tokenizer_next(matteTokenizer_t * t, matteTokenType_t ty) {
             t->backup = t->iter;
 
             return new_token(
+                t,
                 out, //xfer ownership
                 currentLine,
                 currentCh,
@@ -1009,6 +1134,7 @@ matteToken_t * matte_tokenizer_next(matteTokenizer_t * t, matteTokenType_t ty) {
         matte_string_append_char(text, c);
         t->character+=matte_string_get_length(text);
         return new_token(
+            t,
             text,
             currentLine,
             currentCh,
@@ -1031,6 +1157,7 @@ matteToken_t * matte_tokenizer_next(matteTokenizer_t * t, matteTokenType_t ty) {
                 t->character += 4;
                 t->backup = t->iter;
                 return new_token(
+                    t,
                     matte_string_create_from_c_str("%s", "true"),
                     currentLine,
                     currentCh,
@@ -1053,6 +1180,7 @@ matteToken_t * matte_tokenizer_next(matteTokenizer_t * t, matteTokenType_t ty) {
                 t->character += 5;
                 t->backup = t->iter;
                 return new_token(
+                    t,
                     matte_string_create_from_c_str("%s", "false"),
                     currentLine,
                     currentCh,
@@ -1284,6 +1412,7 @@ matteToken_t * matte_tokenizer_next(matteTokenizer_t * t, matteTokenType_t ty) {
             t->character++;
             t->backup = t->iter;
             return new_token(
+                t,
                 matte_string_create_from_c_str("%c", c),
                 currentLine,
                 currentCh,
@@ -1310,6 +1439,7 @@ matteToken_t * matte_tokenizer_next(matteTokenizer_t * t, matteTokenType_t ty) {
             t->character++;
             t->backup = t->iter;
             return new_token(
+                t,
                 matte_string_create_from_c_str("%c", c),
                 currentLine,
                 currentCh,
@@ -1327,6 +1457,7 @@ matteToken_t * matte_tokenizer_next(matteTokenizer_t * t, matteTokenType_t ty) {
                 t->character+=2;
                 t->backup = t->iter;
                 return new_token(
+                    t,
                     matte_string_create_from_c_str("|%c", c),
                     currentLine,
                     currentCh,
@@ -1337,6 +1468,7 @@ matteToken_t * matte_tokenizer_next(matteTokenizer_t * t, matteTokenType_t ty) {
               default:
                 t->iter = t->backup;
                 return new_token(
+                    t,
                     matte_string_create_from_c_str("|", c),
                     currentLine,
                     currentCh,
@@ -1355,6 +1487,7 @@ matteToken_t * matte_tokenizer_next(matteTokenizer_t * t, matteTokenType_t ty) {
                 t->character++;
                 t->backup = t->iter;
                 return new_token(
+                    t,
                     matte_string_create_from_c_str("&%c", c),
                     currentLine,
                     currentCh,
@@ -1365,6 +1498,7 @@ matteToken_t * matte_tokenizer_next(matteTokenizer_t * t, matteTokenType_t ty) {
               default:
                 t->iter = t->backup;
                 return new_token(
+                    t,
                     matte_string_create_from_c_str("&", c),
                     currentLine,
                     currentCh,
@@ -1385,6 +1519,7 @@ matteToken_t * matte_tokenizer_next(matteTokenizer_t * t, matteTokenType_t ty) {
                 t->character++;
                 t->backup = t->iter;
                 return new_token(
+                    t,
                     matte_string_create_from_c_str("<%c", c),
                     currentLine,
                     currentCh,
@@ -1395,6 +1530,7 @@ matteToken_t * matte_tokenizer_next(matteTokenizer_t * t, matteTokenType_t ty) {
               default:
                 t->iter = t->backup;
                 return new_token(
+                    t,
                     matte_string_create_from_c_str("<", c),
                     currentLine,
                     currentCh,
@@ -1414,6 +1550,7 @@ matteToken_t * matte_tokenizer_next(matteTokenizer_t * t, matteTokenType_t ty) {
                 t->character++;
                 t->backup = t->iter;
                 return new_token(
+                    t,
                     matte_string_create_from_c_str(">%c", c),
                     currentLine,
                     currentCh,
@@ -1424,6 +1561,7 @@ matteToken_t * matte_tokenizer_next(matteTokenizer_t * t, matteTokenType_t ty) {
               default:
                 t->iter = t->backup;
                 return new_token(
+                    t,
                     matte_string_create_from_c_str(">", c),
                     currentLine,
                     currentCh,
@@ -1441,6 +1579,7 @@ matteToken_t * matte_tokenizer_next(matteTokenizer_t * t, matteTokenType_t ty) {
                 t->character++;
                 t->backup = t->iter;
                 return new_token(
+                    t,
                     matte_string_create_from_c_str("*%c", c),
                     currentLine,
                     currentCh,
@@ -1451,6 +1590,7 @@ matteToken_t * matte_tokenizer_next(matteTokenizer_t * t, matteTokenType_t ty) {
               default:
                 t->iter = t->backup;
                 return new_token(
+                    t,
                     matte_string_create_from_c_str("*", c),
                     currentLine,
                     currentCh,
@@ -1467,6 +1607,7 @@ matteToken_t * matte_tokenizer_next(matteTokenizer_t * t, matteTokenType_t ty) {
                 t->character+=2;
                 t->backup = t->iter;
                 return new_token(
+                    t,
                     matte_string_create_from_c_str("=%c", c),
                     currentLine,
                     currentCh,
@@ -1491,6 +1632,7 @@ matteToken_t * matte_tokenizer_next(matteTokenizer_t * t, matteTokenType_t ty) {
                 t->character+=2;
                 t->backup = t->iter;
                 return new_token(
+                    t,
                     matte_string_create_from_c_str("!%c", c),
                     currentLine,
                     currentCh,
@@ -1521,6 +1663,7 @@ matteToken_t * matte_tokenizer_next(matteTokenizer_t * t, matteTokenType_t ty) {
               default:
                 t->iter = t->backup;
                 return new_token(
+                    t,
                     matte_string_create_from_c_str("-", c),
                     currentLine,
                     currentCh,
@@ -1534,19 +1677,19 @@ matteToken_t * matte_tokenizer_next(matteTokenizer_t * t, matteTokenType_t ty) {
         break;
       }
       case MATTE_TOKEN_VARIABLE_NAME: {
-        matteString_t * varname = consume_variable_name(&t->iter);
+        matteString_t * varname = consume_variable_name(&t->iter, t->scratch);
         if (matte_string_get_length(varname)) {
             t->character += matte_string_get_length(varname);
             t->backup = t->iter;
             return new_token(
-                varname,
+                t,
+                matte_string_clone(varname),
                 currentLine,
                 currentCh,
                 ty
             );
         } else {
             t->iter = t->backup;
-            matte_string_destroy(varname);
             t->line = preLine;
             t->character = preCh;
             return NULL;
@@ -1701,6 +1844,7 @@ matteToken_t * matte_tokenizer_next(matteTokenizer_t * t, matteTokenType_t ty) {
             t->character = 1;
             t->backup = t->iter;
             return new_token(
+                t,
                 matte_string_create_from_c_str(""),
                 currentLine,
                 currentCh,
@@ -1712,6 +1856,7 @@ matteToken_t * matte_tokenizer_next(matteTokenizer_t * t, matteTokenType_t ty) {
             t->character = 1;
             t->backup = t->iter;
             return new_token(
+                t,
                 matte_string_create_from_c_str("\n"),
                 currentLine,
                 currentCh,
@@ -1721,6 +1866,7 @@ matteToken_t * matte_tokenizer_next(matteTokenizer_t * t, matteTokenType_t ty) {
             t->character++;
             t->backup = t->iter;
             return new_token(
+                t,
                 matte_string_create_from_c_str(";"),
                 currentLine,
                 currentCh,
@@ -2017,6 +2163,7 @@ static matteSyntaxGraphNode_t * matte_syntax_graph_walk_helper(
             // markers do not consume text.
             if (node->token.marker) {
                 newT = new_token(
+                    graph->tokenizer,
                     matte_string_create_from_c_str(""),
                     graph->tokenizer->line,
                     graph->tokenizer->character,
@@ -2411,6 +2558,7 @@ static void function_block_destroy(matteFunctionBlock_t * t) {
         matte_string_destroy(matte_array_at(t->args, matteString_t *, i));        
     }
     matte_array_destroy(t->args);
+    matte_array_destroy(t->arg_isNumber);
 
     len = matte_array_get_size(t->strings);
     for(i = 0; i < len; ++i) {
@@ -2851,7 +2999,9 @@ static int op_to_precedence(int op) {
     return 999;
 }
 
+// Nodes live in the tokenizer's arena and are released with it.
 static matteExpressionNode_t * new_expression_node(
+    matteSyntaxGraphWalker_t * g,
     int preOp,
     int postOp,
     int appearanceID,
@@ -2859,7 +3009,7 @@ static matteExpressionNode_t * new_expression_node(
     // xfer ownership
     matteArray_t * value
 ) {
-    matteExpressionNode_t * out = (matteExpressionNode_t*)matte_allocate(sizeof(matteExpressionNode_t));
+    matteExpressionNode_t * out = (matteExpressionNode_t*)compiler_arena_allocate(&g->tokenizer->arena, sizeof(matteExpressionNode_t));
     out->preOp = preOp;
     out->postOp = postOp;
     out->appearanceID = appearanceID;
@@ -4289,6 +4439,7 @@ static matteArray_t * compile_expression(
 
         }
         matteExpressionNode_t * exp = new_expression_node(
+            g,
             preOp,
             postOp,
             appearanceID,
@@ -4419,9 +4570,7 @@ static matteArray_t * compile_expression(
 
     // whew... now cleanup thanks
     // at this point, all nodes "value" attributes have been cleaned and transfered.
-    for(i = 0; i < len; ++i) {
-        matte_deallocate(matte_array_at(nodes, matteExpressionNode_t *, i));
-    }
+    // The nodes themselves go away with the tokenizer.
     matte_array_destroy(nodes);
 
 
@@ -4610,7 +4759,7 @@ static int compile_statement(
         }
         merge_instructions(block->instructions, inst);
         write_instruction__arf(block->instructions, oln, gl, 0); // no special operator
-
+        write_instruction__pop(block->instructions, oln, 1);
 
         break;
       }
@@ -4735,6 +4884,7 @@ static matteFunctionBlock_t * create_function_block(
     matteFunctionBlock_t * b = (matteFunctionBlock_t*)matte_allocate(sizeof(matteFunctionBlock_t));
     b->startingLine = iter->line;
     b->args = matte_array_create(sizeof(matteString_t *));
+    b->arg_isNumber = matte_array_create(sizeof(int));
     b->strings = matte_array_create(sizeof(matteString_t *));
     b->locals = matte_array_create(sizeof(matteString_t *));
     b->local_isConst = matte_array_create(sizeof(int));
@@ -4794,6 +4944,8 @@ static matteFunctionBlock_t * compile_function_block(
                 while(iter && iter->ttype == MATTE_TOKEN_VARIABLE_NAME) {
                     matteString_t * arg = matte_string_clone((matteString_t*)iter->data);
                     matte_array_push(b->args, arg);
+                    int isNumber = 0;
+                    matte_array_push(b->arg_isNumber, isNumber);
                     #ifdef MATTE_DEBUG__COMPILER
                         printf("  - Argument %d: %s\n", matte_array_get_size(b->args), matte_string_get_c_str(arg));
                     #endif
@@ -4826,6 +4978,12 @@ static matteFunctionBlock_t * compile_function_block(
                         if (!expInst) {
                             goto L_FAIL;
                         }                      
+                        if (matte_array_get_size(expInst) == 1) {
+                            matteBytecodeStubInstruction_t * type = &matte_array_at(expInst, matteBytecodeStubInstruction_t, 0);
+                            if (type->info.opcode == MATTE_OPCODE_PTO && type->data == 2) {
+                                matte_array_at(b->arg_isNumber, int, matte_array_get_size(b->arg_isNumber)-1) = 1;
+                            }
+                        }
                         merge_instructions(b->typestrict_types, expInst);
 
                     } else if (b->typestrict_types) {
@@ -4869,7 +5027,7 @@ static matteFunctionBlock_t * compile_function_block(
                         write_instruction__skp_insert(
                             b->instructions, 
                             GET_LINE_OFFSET(b),
-                            matte_array_get_size(expInst)+1 // skip expression+arf
+                            matte_array_get_size(expInst)+2 // skip expression+arf+pop
                         );
 
                         write_instruction__arf(
@@ -4878,6 +5036,11 @@ static matteFunctionBlock_t * compile_function_block(
                             matte_array_get_size(b->args)-1, 
                             0
                         );
+                        write_instruction__pop(
+                            expInst, 
+                            GET_LINE_OFFSET(b),
+                            1
+                        );
                         
                         merge_instructions(
                             b->instructions,
@@ -4992,6 +5155,905 @@ static matteFunctionBlock_t * compile_function_block(
     return NULL;
 }
 
+/////////////////////////////////////////////////////////////
+// Optimization
+//
+// Works on the finished instructions of each function block:
+// operators with constant operands are computed ahead of time, 
+// branches on constant conditions are resolved, and code that 
+// can never run is removed. Anything that could behave differently 
+// at runtime (errors, conversions, operator overloading) is left alone.
+
+
+// Numbers lose their lowest significand bit when stored 
+// by the VM, so folding does the same to match.
+static double optimize_number(double d) {
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(double));
+    bits = (bits >> 1) << 1;
+    memcpy(&d, &bits, sizeof(double));
+    return d;
+}
+
+static int optimize_is_constant(const matteBytecodeStubInstruction_t * inst) {
+    return inst->info.opcode == MATTE_OPCODE_NNM ||
+           inst->info.opcode == MATTE_OPCODE_NBL ||
+           inst->info.opcode == MATTE_OPCODE_NST;
+}
+
+static int optimize_is_jump(const matteBytecodeStubInstruction_t * inst) {
+    return inst->info.opcode == MATTE_OPCODE_SKP ||
+           inst->info.opcode == MATTE_OPCODE_ASP ||
+           inst->info.opcode == MATTE_OPCODE_SCA ||
+           inst->info.opcode == MATTE_OPCODE_SCO;
+}
+
+static void optimize_into_number(matteBytecodeStubInstruction_t * inst, double val) {
+    inst->info.opcode = MATTE_OPCODE_NNM;
+    inst->data = optimize_number(val);
+}
+
+static void optimize_into_boolean(matteBytecodeStubInstruction_t * inst, int val) {
+    inst->info.opcode = MATTE_OPCODE_NBL;
+    inst->data = val ? 1 : 0;
+}
+
+// Computes a unary operator on a constant, replacing the constant 
+// with the result. Returns 0 if the operator was not computed.
+static int optimize_fold_1(matteBytecodeStubInstruction_t * a, int op) {
+    if (a->info.opcode == MATTE_OPCODE_NNM && op == MATTE_OPERATOR_NEGATE) {
+        optimize_into_number(a, -optimize_number(a->data));
+        return 1;
+    }
+    if (a->info.opcode == MATTE_OPCODE_NBL && op == MATTE_OPERATOR_NOT) {
+        optimize_into_boolean(a, a->data == 0.0);
+        return 1;
+    }
+    return 0;
+}
+
+// Computes a binary operator on 2 constants, replacing the 
+// first with the result. Returns 0 if the operator was not computed.
+static int optimize_fold_2(
+    matteFunctionBlock_t * block, 
+    matteBytecodeStubInstruction_t * a, 
+    const matteBytecodeStubInstruction_t * b, 
+    int op
+) {
+    if (a->info.opcode != b->info.opcode) return 0;
+    switch(a->info.opcode) {
+      case MATTE_OPCODE_NNM: {
+        double x = optimize_number(a->data);
+        double y = optimize_number(b->data);
+        switch(op) {
+          case MATTE_OPERATOR_ADD:       optimize_into_number(a, x + y); return 1;
+          case MATTE_OPERATOR_SUB:       optimize_into_number(a, x - y); return 1;
+          case MATTE_OPERATOR_MULT:      optimize_into_number(a, x * y); return 1;
+          case MATTE_OPERATOR_DIV:       optimize_into_number(a, x / y); return 1;
+          case MATTE_OPERATOR_POW:       optimize_into_number(a, pow(x, y)); return 1;
+          case MATTE_OPERATOR_MODULO:    optimize_into_number(a, fmod(x, y)); return 1;
+          case MATTE_OPERATOR_EQ:        optimize_into_boolean(a, x == y); return 1;
+          case MATTE_OPERATOR_NOTEQ:     optimize_into_boolean(a, x != y); return 1;
+          case MATTE_OPERATOR_LESS:      optimize_into_boolean(a, x < y); return 1;
+          case MATTE_OPERATOR_GREATER:   optimize_into_boolean(a, x > y); return 1;
+          case MATTE_OPERATOR_LESSEQ:    optimize_into_boolean(a, x <= y); return 1;
+          case MATTE_OPERATOR_GREATEREQ: optimize_into_boolean(a, x >= y); return 1;
+        }
+        return 0;
+      }
+      
+      case MATTE_OPCODE_NBL: {
+        int x = a->data != 0.0;
+        int y = b->data != 0.0;
+        switch(op) {
+          case MATTE_OPERATOR_EQ:    optimize_into_boolean(a, x == y); return 1;
+          case MATTE_OPERATOR_NOTEQ: optimize_into_boolean(a, x != y); return 1;
+          case MATTE_OPERATOR_AND:   optimize_into_boolean(a, x && y); return 1;
+          case MATTE_OPERATOR_OR:    optimize_into_boolean(a, x || y); return 1;
+        }
+        return 0;
+      }
+      
+      case MATTE_OPCODE_NST: {
+        uint32_t count = matte_array_get_size(block->strings);
+        if ((uint32_t)a->data >= count || (uint32_t)b->data >= count) return 0;
+        const matteString_t * x = matte_array_at(block->strings, matteString_t *, (uint32_t)a->data);
+        const matteString_t * y = matte_array_at(block->strings, matteString_t *, (uint32_t)b->data);
+        switch(op) {
+          case MATTE_OPERATOR_EQ:    optimize_into_boolean(a,  matte_string_test_eq(x, y)); return 1;
+          case MATTE_OPERATOR_NOTEQ: optimize_into_boolean(a, !matte_string_test_eq(x, y)); return 1;
+          case MATTE_OPERATOR_ADD: {
+            matteString_t * str = matte_string_clone(x);
+            matte_string_concat(str, y);
+            a->data = function_intern_string(block, str);
+            matte_string_destroy(str);
+            return 1;
+          }
+        }
+        return 0;
+      }
+    }
+    return 0;
+}
+
+
+// Runs one round of optimization over the block.
+// Returns whether any changes were made.
+// Removes the instructions flagged in removed (one flag per 
+// instruction), relocating jumps to land where they used to.
+// A jump to a removed instruction lands on the next kept one.
+static void function_block_remove_instructions(matteFunctionBlock_t * block, const uint8_t * removed) {
+    uint32_t len = matte_array_get_size(block->instructions);
+    matteBytecodeStubInstruction_t * insts = (matteBytecodeStubInstruction_t*)matte_array_get_data(block->instructions);
+    uint32_t i;
+    // newIndex[i] is where original instruction i ends up, or 
+    // for removed instructions, where the next kept one ends up.
+    uint32_t * newIndex = (uint32_t*)matte_allocate((len+1) * sizeof(uint32_t));
+    uint32_t next = 0;
+    for(i = 0; i < len; ++i) {
+        if (!removed[i]) next++;
+    }
+    newIndex[len] = next;
+    for(i = len; i > 0; --i) {
+        if (!removed[i-1]) next--;
+        newIndex[i-1] = next;
+    }
+    
+    for(i = 0; i < len; ++i) {
+        if (removed[i] || !optimize_is_jump(insts+i)) continue;
+        uint64_t target = i + 1 + (uint64_t)insts[i].data;
+        if (target > len) target = len;
+        insts[i].data = newIndex[target] - (newIndex[i] + 1);
+    }
+    
+    uint32_t out = 0;
+    for(i = 0; i < len; ++i) {
+        if (removed[i]) continue;
+        insts[out++] = insts[i];
+    }
+    matte_array_set_size(block->instructions, out);
+    matte_deallocate(newIndex);
+}
+
+static int function_block_optimize_pass(matteFunctionBlock_t * block) {
+    uint32_t len = matte_array_get_size(block->instructions);
+    if (!len) return 0;
+    matteBytecodeStubInstruction_t * insts = (matteBytecodeStubInstruction_t*)matte_array_get_data(block->instructions);
+    
+    // instructions that are landed on by a jump. The end 
+    // of the block may also be a target.
+    uint8_t * isTarget = (uint8_t*)matte_allocate(len+1);
+    uint8_t * removed = (uint8_t*)matte_allocate(len+1);
+    // original indices of instructions that are kept so far
+    uint32_t * kept = (uint32_t*)matte_allocate(len * sizeof(uint32_t));
+    uint32_t keptCount = 0;
+    int changed = 0;
+    uint32_t i;
+    
+    for(i = 0; i < len; ++i) {
+        if (!optimize_is_jump(insts+i)) continue;
+        uint64_t target = i + 1 + (uint64_t)insts[i].data;
+        isTarget[target > len ? len : target] = 1;
+    }
+    
+    for(i = 0; i < len; ++i) {
+        matteBytecodeStubInstruction_t * inst = insts+i;
+        
+        // only instructions that directly follow the constants 
+        // they work with, with nothing jumping into the middle,
+        // can be resolved.
+        matteBytecodeStubInstruction_t * prev0 = NULL;
+        matteBytecodeStubInstruction_t * prev1 = NULL;
+        if (!isTarget[i] && keptCount >= 1 && optimize_is_constant(insts + kept[keptCount-1])) {
+            prev0 = insts + kept[keptCount-1];
+            if (keptCount >= 2 && !isTarget[kept[keptCount-1]] && optimize_is_constant(insts + kept[keptCount-2]))
+                prev1 = insts + kept[keptCount-2];
+        }
+        
+        switch(inst->info.opcode) {
+          case MATTE_OPCODE_OPR: {
+            int op = (int)inst->data;
+            if (prev1 && optimize_fold_2(block, prev1, prev0, op)) {
+                removed[kept[--keptCount]] = 1;
+                removed[i] = 1;
+                changed = 1;
+                continue;
+            }
+            if (prev0 && (op == MATTE_OPERATOR_NEGATE || op == MATTE_OPERATOR_NOT) && optimize_fold_1(prev0, op)) {
+                removed[i] = 1;
+                changed = 1;
+                continue;
+            }
+            break;
+          }
+          
+          case MATTE_OPCODE_SKP: {
+            if (!prev0 || prev0->info.opcode != MATTE_OPCODE_NBL) break;
+            removed[kept[--keptCount]] = 1;
+            changed = 1;
+            if (prev0->data != 0.0) {
+                // never skips
+                removed[i] = 1;
+                continue;
+            }
+            // always skips
+            inst->info.opcode = MATTE_OPCODE_ASP;
+            break;
+          }
+          
+          case MATTE_OPCODE_ASP: {
+            if ((uint32_t)inst->data == 0) {
+                removed[i] = 1;
+                changed = 1;
+                continue;
+            }
+            break;
+          }
+        }
+        
+        kept[keptCount++] = i;
+        
+        // anything after an unconditional jump or return 
+        // is unreachable until something jumps to it.
+        if (inst->info.opcode == MATTE_OPCODE_ASP || inst->info.opcode == MATTE_OPCODE_RET) {
+            while(i+1 < len && !isTarget[i+1]) {
+                removed[++i] = 1;
+                changed = 1;
+            }
+        }
+    }
+    
+    if (changed)
+        function_block_remove_instructions(block, removed);
+    
+    matte_deallocate(kept);
+    matte_deallocate(isTarget);
+    matte_deallocate(removed);
+    return changed;
+}
+
+static int optimize_is_binary_operator(int op) {
+    switch(op) {
+      case MATTE_OPERATOR_ADD:
+      case MATTE_OPERATOR_SUB:
+      case MATTE_OPERATOR_DIV:
+      case MATTE_OPERATOR_MULT:
+      case MATTE_OPERATOR_BITWISE_OR:
+      case MATTE_OPERATOR_OR:
+      case MATTE_OPERATOR_BITWISE_AND:
+      case MATTE_OPERATOR_AND:
+      case MATTE_OPERATOR_SHIFT_LEFT:
+      case MATTE_OPERATOR_SHIFT_RIGHT:
+      case MATTE_OPERATOR_POW:
+      case MATTE_OPERATOR_EQ:
+      case MATTE_OPERATOR_POINT:
+      case MATTE_OPERATOR_TERNARY:
+      case MATTE_OPERATOR_GREATER:
+      case MATTE_OPERATOR_LESS:
+      case MATTE_OPERATOR_GREATEREQ:
+      case MATTE_OPERATOR_LESSEQ:
+      case MATTE_OPERATOR_TRANSFORM:
+      case MATTE_OPERATOR_MODULO:
+      case MATTE_OPERATOR_CARET:
+      case MATTE_OPERATOR_TYPESPEC:
+      case MATTE_OPERATOR_NOTEQ:
+        return 1;
+    }
+    return 0;
+}
+
+// Peephole pass: marks the start of common opcode sequences
+// with a superinstruction. Only the first opcode is replaced;
+// the rest of the sequence stays so that no jumps need to be
+// relocated and anything jumping into the middle still works.
+static void function_block_fuse(matteFunctionBlock_t * block) {
+    uint32_t len = matte_array_get_size(block->instructions);
+    matteBytecodeStubInstruction_t * insts = (matteBytecodeStubInstruction_t*)matte_array_get_data(block->instructions);
+    uint32_t i;
+    for(i = 0; i+1 < len; ++i) {
+        matteBytecodeStubInstruction_t * a = insts+i;
+        matteBytecodeStubInstruction_t * b = insts+i+1;
+        matteBytecodeStubInstruction_t * c = i+2 < len ? insts+i+2 : NULL;
+
+        // keep line change events exact for the debugger.
+        if (b->info.lineOffset != a->info.lineOffset) continue;
+        if (c && c->info.lineOffset != a->info.lineOffset) c = NULL;
+
+        switch(a->info.opcode) {
+          case MATTE_OPCODE_PRF:
+            if (!c) break;
+            if (b->info.opcode == MATTE_OPCODE_NST && c->info.opcode == MATTE_OPCODE_OLK) {
+                a->info.opcode = MATTE_OPCODE_RSL;
+                i += 2;
+            } else if (b->info.opcode == MATTE_OPCODE_NNM && c->info.opcode == MATTE_OPCODE_OPR && optimize_is_binary_operator((int)c->data)) {
+                a->info.opcode = MATTE_OPCODE_RNO;
+                i += 2;
+            }
+            break;
+
+          case MATTE_OPCODE_OPR:
+            if (b->info.opcode == MATTE_OPCODE_ARF) {
+                a->info.opcode = MATTE_OPCODE_OAR;
+                i += 1;
+            }
+            break;
+
+          case MATTE_OPCODE_CPY:
+            if (b->info.opcode == MATTE_OPCODE_POP) {
+                a->info.opcode = MATTE_OPCODE_CPP;
+                i += 1;
+            }
+            break;
+
+          case MATTE_OPCODE_ARF:
+            if (b->info.opcode == MATTE_OPCODE_POP) {
+                a->info.opcode = MATTE_OPCODE_ARP;
+                i += 1;
+            }
+            break;
+        }
+    }
+}
+
+// Register form: statements that compute a value from referrables
+// and constants and store it in a referrable are rewritten as one
+// three-address instruction that reads and writes the frame's
+// referrable slots directly, never touching the value stack.
+//
+// args.slot0 holds the operation and operand kinds,
+// args.slot1 the destination referrable and args.slot2/3 the operands.
+// An operand is either a referrable or, with its kind bit set,
+// a small integer stored in the slot itself.
+
+// Gets a register operand from a PRF or NNM instruction.
+static int register_form_operand(const matteBytecodeStubInstruction_t * inst, uint16_t * slot, int * immediate) {
+    if (inst->info.opcode == MATTE_OPCODE_PRF) {
+        if (inst->data > 0xffff) return 0;
+        *slot = (uint16_t)inst->data;
+        *immediate = 0;
+        return 1;
+    }
+    if (inst->info.opcode == MATTE_OPCODE_NNM) {
+        double d = inst->data;
+        // -0 would come back as 0.
+        if (!(d >= INT16_MIN && d <= INT16_MAX) || d != (double)(int16_t)d || (d == 0 && signbit(d))) return 0;
+        *slot = (uint16_t)(int16_t)inst->data;
+        *immediate = 1;
+        return 1;
+    }
+    return 0;
+}
+
+// Gets the destination and assignment operator of an ARF followed by 
+// a POP of its result.
+static int register_form_destination(
+    const matteBytecodeStubInstruction_t * arf, 
+    const matteBytecodeStubInstruction_t * pop,
+    uint16_t * slot,
+    int * op
+) {
+    if (arf->info.opcode != MATTE_OPCODE_ARF ||
+        pop->info.opcode != MATTE_OPCODE_POP ||
+        (uint32_t)pop->data != 1) return 0;
+    uint64_t refn = ((uint64_t)arf->data) % 0xffffffff;
+    uint64_t assign = ((uint64_t)arf->data) / 0xffffffff;
+    if (refn > 0xffff || assign > 0xff) return 0;
+    *slot = (uint16_t)refn;
+    *op = (int)assign;
+    return 1;
+}
+
+static void function_block_to_register_form(matteFunctionBlock_t * block) {
+    uint32_t len = matte_array_get_size(block->instructions);
+    if (!len) return;
+    matteBytecodeStubInstruction_t * insts = (matteBytecodeStubInstruction_t*)matte_array_get_data(block->instructions);
+    uint8_t * isTarget = (uint8_t*)matte_allocate(len+1);
+    uint8_t * removed = (uint8_t*)matte_allocate(len+1);
+    int changed = 0;
+    uint32_t i, n;
+    
+    for(i = 0; i < len; ++i) {
+        if (!optimize_is_jump(insts+i)) continue;
+        uint64_t target = i + 1 + (uint64_t)insts[i].data;
+        isTarget[target > len ? len : target] = 1;
+    }
+
+    for(i = 0; i < len; ++i) {
+        matteBytecodeStubInstruction_t * inst = insts+i;
+
+        // the longest form spans 5 instructions. Only the first 
+        // may be jumped to, and all must be on the same line.
+        uint32_t avail = 1;
+        while(avail < 5 && i+avail < len && !isTarget[i+avail] && insts[i+avail].info.lineOffset == inst->info.lineOffset)
+            avail++;
+
+        uint16_t dst, a, b;
+        int aImm, bImm, op;
+        matteBytecodeStubInstruction_t out = *inst;
+        uint32_t used = 0;
+        
+        // a op b -> dst
+        if (avail >= 5 &&
+            register_form_operand(insts+i, &a, &aImm) &&
+            register_form_operand(insts+i+1, &b, &bImm) &&
+            insts[i+2].info.opcode == MATTE_OPCODE_OPR &&
+            optimize_is_binary_operator((int)insts[i+2].data) &&
+            register_form_destination(insts+i+3, insts+i+4, &dst, &op) &&
+            op == 0
+        ) {
+            out.info.opcode = MATTE_OPCODE_ROP;
+            out.args.slot0 = (uint16_t)insts[i+2].data | (aImm << 8) | (bImm << 9);
+            out.args.slot1 = dst;
+            out.args.slot2 = a;
+            out.args.slot3 = b;
+            used = 5;
+
+        // a.key -> dst
+        } else if (avail >= 5 &&
+            insts[i].info.opcode == MATTE_OPCODE_PRF &&
+            register_form_operand(insts+i, &a, &aImm) &&
+            insts[i+1].info.opcode == MATTE_OPCODE_NST &&
+            insts[i+1].data <= 0xffff &&
+            insts[i+2].info.opcode == MATTE_OPCODE_OLK &&
+            register_form_destination(insts+i+3, insts+i+4, &dst, &op) &&
+            op == 0
+        ) {
+            out.info.opcode = MATTE_OPCODE_RLK;
+            out.args.slot0 = (uint16_t)insts[i+2].data;
+            out.args.slot1 = dst;
+            out.args.slot2 = a;
+            out.args.slot3 = (uint16_t)insts[i+1].data;
+            used = 5;
+
+        // dst (assignment op) a
+        } else if (avail >= 3 &&
+            register_form_operand(insts+i, &a, &aImm) &&
+            register_form_destination(insts+i+1, insts+i+2, &dst, &op)
+        ) {
+            out.info.opcode = MATTE_OPCODE_RAS;
+            out.args.slot0 = op | (aImm << 8);
+            out.args.slot1 = dst;
+            out.args.slot2 = a;
+            out.args.slot3 = 0;
+            used = 3;
+        }
+
+        if (!used) continue;
+        *inst = out;
+        for(n = 1; n < used; ++n) {
+            removed[i+n] = 1;
+        }
+        i += used-1;
+        changed = 1;
+    }
+
+    if (changed)
+        function_block_remove_instructions(block, removed);
+    matte_deallocate(isTarget);
+    matte_deallocate(removed);
+}
+
+// Number specialization: tracks which of the values most recently 
+// pushed are known to be numbers, either from number literals or 
+// from arguments declared as Numbers, and swaps in number-only opcodes 
+// for operators that work on two of them. The argument type is 
+// checked when the function is called, but arguments can be 
+// reassigned afterwards, so the specialized opcodes still check their 
+// operands and fall back to the general operator when needed.
+#define SPECIALIZE_MAX_DEPTH 16
+
+static int specialize_number_opcode(int op) {
+    switch(op) {
+      case MATTE_OPERATOR_ADD:       return MATTE_OPCODE_NAD;
+      case MATTE_OPERATOR_SUB:       return MATTE_OPCODE_NSB;
+      case MATTE_OPERATOR_MULT:      return MATTE_OPCODE_NML;
+      case MATTE_OPERATOR_DIV:       return MATTE_OPCODE_NDV;
+      case MATTE_OPERATOR_LESS:      return MATTE_OPCODE_NLT;
+      case MATTE_OPERATOR_GREATER:   return MATTE_OPCODE_NGT;
+      case MATTE_OPERATOR_LESSEQ:    return MATTE_OPCODE_NLE;
+      case MATTE_OPERATOR_GREATEREQ: return MATTE_OPCODE_NGE;
+      case MATTE_OPERATOR_EQ:        return MATTE_OPCODE_NEQ;
+      case MATTE_OPERATOR_NOTEQ:     return MATTE_OPCODE_NNE;
+    }
+    return -1;
+}
+
+static void function_block_specialize_numbers(matteFunctionBlock_t * block) {
+    uint32_t len = matte_array_get_size(block->instructions);
+    if (!len) return;
+    matteBytecodeStubInstruction_t * insts = (matteBytecodeStubInstruction_t*)matte_array_get_data(block->instructions);
+    uint32_t nargs = matte_array_get_size(block->arg_isNumber);
+    uint8_t * isTarget = (uint8_t*)matte_allocate(len+1);
+    // whether each tracked stack value is a number, top last.
+    int known[SPECIALIZE_MAX_DEPTH];
+    int depth = 0;
+    uint32_t i;
+
+    for(i = 0; i < len; ++i) {
+        if (!optimize_is_jump(insts+i)) continue;
+        uint64_t target = i + 1 + (uint64_t)insts[i].data;
+        isTarget[target > len ? len : target] = 1;
+    }
+
+    for(i = 0; i < len; ++i) {
+        matteBytecodeStubInstruction_t * inst = insts+i;
+        // the stack could be in any state coming from a jump.
+        if (isTarget[i]) depth = 0;
+        
+        switch(inst->info.opcode) {
+          case MATTE_OPCODE_NNM:
+          case MATTE_OPCODE_PRF: {
+            int isNumber = inst->info.opcode == MATTE_OPCODE_NNM || (
+                inst->data < nargs &&
+                matte_array_at(block->arg_isNumber, int, (uint32_t)inst->data)
+            );
+            if (depth == SPECIALIZE_MAX_DEPTH) {
+                memmove(known, known+1, sizeof(int)*(SPECIALIZE_MAX_DEPTH-1));
+                depth--;
+            }
+            known[depth++] = isNumber;
+            break;
+          }
+            
+          case MATTE_OPCODE_OPR: {
+            int op = (int)inst->data;
+            if (op == MATTE_OPERATOR_NEGATE) {
+                // a negated number is still a number.
+                break;
+            }
+            if (!optimize_is_binary_operator(op) || depth < 2) {
+                depth = 0;
+                break;
+            }
+            int bothNumbers = known[depth-1] && known[depth-2];
+            int specialized = specialize_number_opcode(op);
+            depth -= 2;
+            if (bothNumbers && specialized >= 0) {
+                inst->info.opcode = specialized;
+            }
+            
+            // arithmetic on numbers stays a number.
+            known[depth++] = bothNumbers && (
+                op == MATTE_OPERATOR_ADD ||
+                op == MATTE_OPERATOR_SUB ||
+                op == MATTE_OPERATOR_MULT ||
+                op == MATTE_OPERATOR_DIV ||
+                op == MATTE_OPERATOR_MODULO ||
+                op == MATTE_OPERATOR_POW
+            );
+            break;
+          }
+          
+          default:
+            depth = 0;
+        }
+    }
+    matte_deallocate(isTarget);
+}
+
+static void function_block_optimize(matteFunctionBlock_t * block) {
+    // each pass can uncover more work for the next.
+    int passes = 8;
+    while(passes-- && function_block_optimize_pass(block));
+}
+
+
+/////////////////////////////////////////////////////////////
+// Inlining 
+//
+// A function that is created and called right away with no 
+// arguments, such as a ::<= {} block, can be compiled directly into 
+// the body of the function that creates it. Its locals become 
+// locals of the enclosing function, its captures are resolved 
+// against the enclosing function, and its returns become jumps 
+// to the end of its body. This relies on statements leaving the 
+// value stack as they found it, so that a return always has 
+// exactly its result above the enclosing function's values.
+
+
+static matteFunctionBlock_t * inline_find_block(matteArray_t * arr, uint32_t stubID) {
+    uint32_t i;
+    uint32_t len = matte_array_get_size(arr);
+    for(i = 0; i < len; ++i) {
+        matteFunctionBlock_t * block = matte_array_at(arr, matteFunctionBlock_t *, i);
+        if (block->stubID == stubID) return block;
+    }
+    return NULL;
+}
+
+static int inline_has_opcode(matteFunctionBlock_t * block, int opcode) {
+    uint32_t i;
+    uint32_t len = matte_array_get_size(block->instructions);
+    for(i = 0; i < len; ++i) {
+        if (matte_array_at(block->instructions, matteBytecodeStubInstruction_t, i).info.opcode == opcode)
+            return 1;
+    }
+    return 0;
+}
+
+// Whether any block that is still separate captures referrables of the given block.
+static int inline_is_captured(matteArray_t * arr, matteFunctionBlock_t * block, matteTable_t * removed) {
+    uint32_t i, n;
+    uint32_t len = matte_array_get_size(arr);
+    for(i = 0; i < len; ++i) {
+        matteFunctionBlock_t * other = matte_array_at(arr, matteFunctionBlock_t *, i);
+        if (matte_table_find_by_uint(removed, other->stubID)) continue;
+        uint32_t ncaps = matte_array_get_size(other->captures);
+        for(n = 0; n < ncaps; ++n) {
+            if (matte_array_at(other->captures, matteBytecodeStubCapture_t, n).stubID == block->stubID)
+                return 1;
+        }
+    }
+    return 0;
+}
+
+// Whether the block can be placed into the given parent.
+static int inline_is_candidate(matteArray_t * arr, matteFunctionBlock_t * parent, matteFunctionBlock_t * block, matteTable_t * removed) {
+    if (block->parent != parent ||
+        block->isEmpty ||
+        block->isVarArg ||
+        block->typestrict ||
+        matte_array_get_size(block->args) ||
+        matte_array_get_size(block->locals) + matte_array_get_size(parent->locals) > FUNCTION_LOCAL_MAX ||
+        block->startingLine < parent->startingLine) return 0;
+
+    // each call needs its own locals if anything can hold on to them.
+    if (inline_is_captured(arr, block, removed)) return 0;
+
+    // the private binding and named lookups depend on the frame.
+    if (inline_has_opcode(block, MATTE_OPCODE_PIP) ||
+        inline_has_opcode(block, MATTE_OPCODE_PNR)) return 0;
+
+    uint32_t i;
+    uint32_t len = matte_array_get_size(block->instructions);
+    for(i = 0; i < len; ++i) {
+        if (block->startingLine - parent->startingLine + 
+            matte_array_at(block->instructions, matteBytecodeStubInstruction_t, i).info.lineOffset > 0xffff)
+            return 0;
+    }
+    return 1;
+}
+
+// Gets the referrable of the parent that a capture of the block refers to.
+static uint32_t inline_map_capture(matteFunctionBlock_t * parent, matteFunctionBlock_t * block, uint32_t index) {
+    matteBytecodeStubCapture_t capture = matte_array_at(block->captures, matteBytecodeStubCapture_t, index);
+    if (capture.stubID == parent->stubID)
+        return capture.referrable;
+    
+    uint32_t base = matte_array_get_size(parent->args) + matte_array_get_size(parent->locals);
+    uint32_t i;
+    uint32_t len = matte_array_get_size(parent->captures);
+    for(i = 0; i < len; ++i) {
+        matteBytecodeStubCapture_t other = matte_array_at(parent->captures, matteBytecodeStubCapture_t, i);
+        if (other.stubID == capture.stubID && other.referrable == capture.referrable)
+            return base + i;
+    }
+    
+    matte_array_push(parent->captures, capture);
+    matteString_t * name = matte_string_clone(matte_array_at(block->captureNames, matteString_t *, index));
+    matte_array_push(parent->captureNames, name);
+    int isConst = matte_array_at(block->capture_isConst, int, index);
+    matte_array_push(parent->capture_isConst, isConst);
+    return base + len;
+}
+
+// Changes the referrable used by a PRF or ARF.
+static void inline_set_referrable(matteBytecodeStubInstruction_t * inst, uint32_t referrable) {
+    if (inst->info.opcode == MATTE_OPCODE_PRF) {
+        inst->data = referrable;
+    } else {
+        uint64_t op = ((uint64_t)inst->data) / 0xffffffff;
+        uint64_t packed = referrable;
+        packed += op * (0xffffffff);
+        inst->data = (double)packed;
+    }
+}
+
+static uint32_t inline_get_referrable(const matteBytecodeStubInstruction_t * inst) {
+    if (inst->info.opcode == MATTE_OPCODE_PRF)
+        return (uint32_t)inst->data;
+    return (uint32_t)(((uint64_t)inst->data) % 0xffffffff);
+}
+
+// Whether a local of the block is always assigned before it is read.
+// Otherwise, it has to be emptied, since the enclosing frame may be 
+// run more than once (loops restart their frame).
+static int inline_local_is_assigned_first(matteFunctionBlock_t * block, uint32_t local) {
+    uint32_t len = matte_array_get_size(block->instructions);
+    matteBytecodeStubInstruction_t * insts = (matteBytecodeStubInstruction_t*)matte_array_get_data(block->instructions);
+    uint32_t i, n;
+    for(i = 0; i < len; ++i) {
+        if (insts[i].info.opcode != MATTE_OPCODE_PRF &&
+            insts[i].info.opcode != MATTE_OPCODE_ARF) continue;
+        if (inline_get_referrable(insts+i) != local) continue;
+        
+        if (insts[i].info.opcode != MATTE_OPCODE_ARF ||
+            ((uint64_t)insts[i].data) / 0xffffffff != 0) return 0;
+        
+        // jumps only go forward, so nothing before this can skip it.
+        for(n = 0; n < i; ++n) {
+            if (optimize_is_jump(insts+n) && n + 1 + (uint64_t)insts[n].data > i)
+                return 0;
+        }
+        return 1;
+    }
+    // never read
+    return 1;
+}
+
+// Replaces the NFN + CAL at the given index of the parent with the 
+// body of the block.
+static void inline_block(matteFunctionBlock_t * parent, matteFunctionBlock_t * block, uint32_t at) {
+    uint32_t i;
+    uint32_t len = matte_array_get_size(parent->instructions);
+    uint32_t nArgs = matte_array_get_size(parent->args);
+    uint32_t nLocals = matte_array_get_size(parent->locals);
+    uint32_t nBlockLocals = matte_array_get_size(block->locals);
+    uint32_t lineShift = block->startingLine - parent->startingLine;
+    uint16_t lineOffset = matte_array_at(parent->instructions, matteBytecodeStubInstruction_t, at).info.lineOffset;
+    
+    // captures of the parent come after its locals, which are about to grow.
+    matteBytecodeStubInstruction_t * insts = (matteBytecodeStubInstruction_t*)matte_array_get_data(parent->instructions);
+    for(i = 0; i < len; ++i) {
+        if (insts[i].info.opcode != MATTE_OPCODE_PRF &&
+            insts[i].info.opcode != MATTE_OPCODE_ARF) continue;
+        uint32_t ref = inline_get_referrable(insts+i);
+        if (ref >= nArgs + nLocals)
+            inline_set_referrable(insts+i, ref + nBlockLocals);
+    }
+    for(i = 0; i < nBlockLocals; ++i) {
+        matteString_t * name = matte_string_clone(matte_array_at(block->locals, matteString_t *, i));
+        matte_array_push(parent->locals, name);
+        int isConst = matte_array_at(block->local_isConst, int, i);
+        matte_array_push(parent->local_isConst, isConst);
+    }
+    
+    
+    matteArray_t * body = matte_array_create(sizeof(matteBytecodeStubInstruction_t));
+    for(i = 0; i < nBlockLocals; ++i) {
+        if (inline_local_is_assigned_first(block, i)) continue;
+        write_instruction__nem(body, lineOffset);
+        write_instruction__arf(body, lineOffset, nArgs + nLocals + i, 0);
+        write_instruction__pop(body, lineOffset, 1);
+    }
+    
+    uint32_t blockLen = matte_array_get_size(block->instructions);
+    matteBytecodeStubInstruction_t * blockInsts = (matteBytecodeStubInstruction_t*)matte_array_get_data(block->instructions);
+
+    // the last return can just fall through, unless something jumps past it.
+    uint32_t end = blockLen;
+    if (blockLen && blockInsts[blockLen-1].info.opcode == MATTE_OPCODE_RET) {
+        end = blockLen-1;
+        for(i = 0; i < blockLen; ++i) {
+            if (optimize_is_jump(blockInsts+i) && i + 1 + (uint64_t)blockInsts[i].data >= blockLen)
+                end = blockLen;
+        }
+    }
+    for(i = 0; i < end; ++i) {
+        matteBytecodeStubInstruction_t inst = matte_array_at(block->instructions, matteBytecodeStubInstruction_t, i);
+        inst.info.lineOffset += lineShift;
+        switch(inst.info.opcode) {
+          case MATTE_OPCODE_PRF:
+          case MATTE_OPCODE_ARF: {
+            uint32_t ref = inline_get_referrable(&inst);
+            if (ref < nBlockLocals) 
+                ref = nArgs + nLocals + ref;
+            else 
+                ref = inline_map_capture(parent, block, ref - nBlockLocals);
+            inline_set_referrable(&inst, ref);
+            break;
+          }
+          case MATTE_OPCODE_NST:
+            inst.data = function_intern_string(parent, matte_array_at(block->strings, matteString_t *, (uint32_t)inst.data));
+            break;
+            
+          case MATTE_OPCODE_RET:
+            // the result is left on the stack.
+            inst.info.opcode = MATTE_OPCODE_ASP;
+            inst.data = end - (i+1);
+            break;
+          default:;
+        }
+        matte_array_push(body, inst);
+    }
+    
+    
+    uint32_t bodyLen = matte_array_get_size(body);
+    uint32_t outLen = len - 2 + bodyLen;
+    // newIndex[i] is where original instruction i of the parent ends up.
+    uint32_t * newIndex = (uint32_t*)matte_allocate((len+1) * sizeof(uint32_t));
+    for(i = 0; i <= len; ++i) {
+        if (i <= at) newIndex[i] = i;
+        else if (i == at+1) newIndex[i] = at;
+        else newIndex[i] = i - 2 + bodyLen;
+    }
+    for(i = 0; i < len; ++i) {
+        if (i == at || i == at+1 || !optimize_is_jump(insts+i)) continue;
+        uint64_t target = i + 1 + (uint64_t)insts[i].data;
+        if (target > len) target = len;
+        insts[i].data = newIndex[target] - (newIndex[i] + 1);
+    }
+    
+    matteArray_t * out = matte_array_create(sizeof(matteBytecodeStubInstruction_t));
+    matte_array_push_n(out, insts, at);
+    matte_array_push_n(out, matte_array_get_data(body), bodyLen);
+    matte_array_push_n(out, insts+at+2, len-at-2);
+    assert(matte_array_get_size(out) == outLen);
+    
+    matte_array_destroy(parent->instructions);
+    parent->instructions = out;
+    matte_array_destroy(body);
+    matte_deallocate(newIndex);
+}
+
+// Inlines all immediately called blocks within the given block,
+// innermost first. Inlined blocks are marked in the removed table.
+static void function_block_inline_calls(matteArray_t * arr, matteFunctionBlock_t * parent, matteTable_t * removed) {
+    // named lookups would see the names of inlined locals.
+    if (inline_has_opcode(parent, MATTE_OPCODE_PNR)) return;
+
+    uint32_t i, n;
+    for(i = 0; i+1 < matte_array_get_size(parent->instructions); ++i) {
+        matteBytecodeStubInstruction_t * insts = (matteBytecodeStubInstruction_t*)matte_array_get_data(parent->instructions);
+        if (insts[i].info.opcode != MATTE_OPCODE_NFN ||
+            insts[i+1].info.opcode != MATTE_OPCODE_CAL) continue;
+        // typestrict functions are preceded by their types.
+        if (i && insts[i-1].info.opcode == MATTE_OPCODE_SFS) continue;
+
+        // nothing can land between the two.
+        int landed = 0;
+        for(n = 0; n < i; ++n) {
+            if (optimize_is_jump(insts+n) && n + 1 + (uint64_t)insts[n].data == i+1)
+                landed = 1;
+        }
+        if (landed) continue;
+
+        matteFunctionBlock_t * block = inline_find_block(arr, insts[i].funcData.stubID);
+        if (!block || matte_table_find_by_uint(removed, block->stubID)) continue;
+
+        function_block_inline_calls(arr, block, removed);
+        if (!inline_is_candidate(arr, parent, block, removed)) continue;
+        
+        uint32_t before = matte_array_get_size(parent->instructions);
+        inline_block(parent, block, i);
+        matte_table_insert_by_uint(removed, block->stubID, block);
+        
+        // skip past the inlined body; it has already been handled.
+        i += matte_array_get_size(parent->instructions) - before + 1;
+    }
+}
+
+static void function_block_array_inline(matteArray_t * arr) {
+    matteTable_t * removed = matte_table_create_hash_pointer();
+    uint32_t i;
+    uint32_t len = matte_array_get_size(arr);
+    for(i = 0; i < len; ++i) {
+        matteFunctionBlock_t * block = matte_array_at(arr, matteFunctionBlock_t *, i);
+        if (matte_table_find_by_uint(removed, block->stubID)) continue;
+        function_block_inline_calls(arr, block, removed);
+    }
+    
+    if (matte_table_is_empty(removed)) {
+        matte_table_destroy(removed);
+        return;
+    }
+
+    uint32_t out = 0;
+    for(i = 0; i < len; ++i) {
+        matteFunctionBlock_t * block = matte_array_at(arr, matteFunctionBlock_t *, i);
+        if (matte_table_find_by_uint(removed, block->stubID)) {
+            function_block_destroy(block);
+        } else {
+            matte_array_at(arr, matteFunctionBlock_t *, out++) = block;
+        }
+    }
+    matte_array_set_size(arr, out);
+    matte_table_destroy(removed);
+}
+
+
+
+
 matteArray_t * matte_syntax_graph_compile(matteSyntaxGraphWalker_t * g) {
     matteToken_t * iter = g->first;
     matteArray_t * arr = matte_array_create(sizeof(matteFunctionBlock_t *));
@@ -5012,14 +6074,68 @@ matteArray_t * matte_syntax_graph_compile(matteSyntaxGraphWalker_t * g) {
 #define WRITE_BYTES(__T__, __VAL__) matte_array_push_n(byteout, &(__VAL__), sizeof(__T__));
 #define WRITE_NBYTES(__N__, __VALP__) matte_array_push_n(byteout, (__VALP__), __N__);
 
-static void write_unistring(matteArray_t * byteout, matteString_t * str) {
-    uint32_t len = matte_string_get_utf8_length(str);
-    WRITE_BYTES(uint32_t, len);
-    WRITE_NBYTES(len, matte_string_get_utf8_data(str));
+// Unsigned LEB128: 7 bits per byte, high bit set when more follow.
+static void write_varuint(matteArray_t * byteout, uint64_t v) {
+    uint8_t b;
+    while(v >= 0x80) {
+        b = (uint8_t)(v & 0x7f) | 0x80;
+        WRITE_BYTES(uint8_t, b);
+        v >>= 7;
+    }
+    b = (uint8_t)v;
+    WRITE_BYTES(uint8_t, b);
+}
+
+static void write_uint32_at(matteArray_t * byteout, uint32_t offset, uint32_t v) {
+    memcpy(((uint8_t*)matte_array_get_data(byteout))+offset, &v, sizeof(uint32_t));
+}
+
+// Returns the pool index of the string, adding it if new.
+static uint32_t bytecode_pool_index(matteArray_t * pool, matteTable_t * poolIndex, matteString_t * str) {
+    uintptr_t index = (uintptr_t)matte_table_find(poolIndex, str);
+    if (index) return index-1;
+    matte_array_push(pool, str);
+    index = matte_array_get_size(pool);
+    matte_table_insert(poolIndex, str, (void*)index);
+    return index-1;
+}
+
+// Picks the smallest operand encoding for an instruction's data.
+static int bytecode_operand_kind(const matteBytecodeStubInstruction_t * inst, uint64_t * value) {
+    uint64_t bits;
+    memcpy(&bits, &inst->data, sizeof(uint64_t));
+    if (bits == 0) return MATTE_BYTECODE_OPERAND__ZERO;
+    
+    if (inst->data > 0 && inst->data < 9007199254740992.0 && inst->data == (double)(uint64_t)inst->data) {
+        *value = (uint64_t)inst->data;
+        if (*value < (((uint64_t)1) << 49)) 
+            return MATTE_BYTECODE_OPERAND__INTEGER;
+    }
+    
+    // packed slots / stub IDs
+    *value = bits;
+    if (bits < (((uint64_t)1) << 49)) 
+        return MATTE_BYTECODE_OPERAND__BITS;
+    return MATTE_BYTECODE_OPERAND__RAW;
+}
+
+// Whether any block captures a referrable owned by the given block.
+static int function_block_referrables_captured(matteArray_t * arr, matteFunctionBlock_t * block) {
+    uint32_t i, n;
+    uint32_t len = matte_array_get_size(arr);
+    for(i = 0; i < len; ++i) {
+        matteFunctionBlock_t * other = matte_array_at(arr, matteFunctionBlock_t *, i);
+        uint32_t ncaps = matte_array_get_size(other->captures);
+        for(n = 0; n < ncaps; ++n) {
+            if (matte_array_at(other->captures, matteBytecodeStubCapture_t, n).stubID == block->stubID)
+                return 1;
+        }
+    }
+    return 0;
 }
 
 void * matte_function_block_array_to_bytecode(
-    matteArray_t * arr, 
+    matteArray_t * arr,
     uint32_t * size
 ) {
     *size = 0;
@@ -5027,56 +6143,108 @@ void * matte_function_block_array_to_bytecode(
     uint32_t i;
     uint32_t len = matte_array_get_size(arr);
     uint32_t n;
-    uint8_t nSlots;
-    uint16_t nCaps;
-    uint32_t nInst;
-    uint32_t nStrings;
+    uint32_t count;
 
     uint8_t tag[] = {
-        'M', 'A', 'T', 0x01, 0x06, 'B', 0x1
+        'M', 'A', 'T', 0x01, 0x06, 'B', MATTE_BYTECODE_VERSION__INDEXED
     };
+
+    // blocks are released as they are written, so gather flags
+    // and the strings used by all blocks first.
+    matteArray_t * captured = matte_array_create(sizeof(uint8_t));
+    matteArray_t * pool = matte_array_create(sizeof(matteString_t *));
+    matteTable_t * poolIndex = matte_table_create_hash_matte_string();
     for(i = 0; i < len; ++i) {
         matteFunctionBlock_t * block = matte_array_at(arr, matteFunctionBlock_t *, i);
+        uint8_t c = function_block_referrables_captured(arr, block);
+        matte_array_push(captured, c);
+
+        count = matte_array_get_size(block->args);
+        for(n = 0; n < count; ++n)
+            bytecode_pool_index(pool, poolIndex, matte_array_at(block->args, matteString_t *, n));
+        count = matte_array_get_size(block->locals);
+        for(n = 0; n < count; ++n)
+            bytecode_pool_index(pool, poolIndex, matte_array_at(block->locals, matteString_t *, n));
+        count = matte_array_get_size(block->strings);
+        for(n = 0; n < count; ++n)
+            bytecode_pool_index(pool, poolIndex, matte_array_at(block->strings, matteString_t *, n));
+    }
 
-        nSlots = 1;
-        WRITE_NBYTES(7, tag); // HEADER + bytecode version
-        WRITE_BYTES(uint32_t, block->stubID);
-        nSlots = block->isVarArg;
-        WRITE_BYTES(uint8_t, nSlots);
+    // header, stub count and stub index, filled in as stubs are written.
+    WRITE_NBYTES(7, tag);
+    WRITE_BYTES(uint32_t, len);
+    uint32_t indexOffset = matte_array_get_size(byteout);
+    matte_array_set_size(byteout, indexOffset + len*2*sizeof(uint32_t));
+
+    // string pool
+    count = matte_array_get_size(pool);
+    write_varuint(byteout, count);
+    for(n = 0; n < count; ++n) {
+        matteString_t * str = matte_array_at(pool, matteString_t *, n);
+        uint32_t strLen = matte_string_get_utf8_length(str);
+        write_varuint(byteout, strLen);
+        WRITE_NBYTES(strLen, matte_string_get_utf8_data(str));
+    }
 
-        nSlots = matte_array_get_size(block->args);
-        WRITE_BYTES(uint8_t, nSlots);
-        for(n = 0; n < nSlots; ++n) {
-            write_unistring(byteout, matte_array_at(block->args, matteString_t *, n));
-        }
 
-        nSlots = matte_array_get_size(block->locals);
-        WRITE_BYTES(uint8_t, nSlots);
-        for(n = 0; n < nSlots; ++n) {
-            write_unistring(byteout, matte_array_at(block->locals, matteString_t *, n));
+    for(i = 0; i < len; ++i) {
+        matteFunctionBlock_t * block = matte_array_at(arr, matteFunctionBlock_t *, i);
+        write_uint32_at(byteout, indexOffset + i*2*sizeof(uint32_t), block->stubID);
+        write_uint32_at(byteout, indexOffset + i*2*sizeof(uint32_t) + sizeof(uint32_t), matte_array_get_size(byteout));
+
+        // flags: vararg, referrables captured
+        write_varuint(byteout, (block->isVarArg ? 1 : 0) | (matte_array_at(captured, uint8_t, i) ? 2 : 0));
+
+        count = matte_array_get_size(block->args);
+        write_varuint(byteout, count);
+        for(n = 0; n < count; ++n)
+            write_varuint(byteout, bytecode_pool_index(pool, poolIndex, matte_array_at(block->args, matteString_t *, n)));
+
+        count = matte_array_get_size(block->locals);
+        write_varuint(byteout, count);
+        for(n = 0; n < count; ++n)
+            write_varuint(byteout, bytecode_pool_index(pool, poolIndex, matte_array_at(block->locals, matteString_t *, n)));
+
+        count = matte_array_get_size(block->strings);
+        write_varuint(byteout, count);
+        for(n = 0; n < count; ++n)
+            write_varuint(byteout, bytecode_pool_index(pool, poolIndex, matte_array_at(block->strings, matteString_t *, n)));
+
+        count = matte_array_get_size(block->captures);
+        write_varuint(byteout, count);
+        for(n = 0; n < count; ++n) {
+            matteBytecodeStubCapture_t * cap = &matte_array_at(block->captures, matteBytecodeStubCapture_t, n);
+            write_varuint(byteout, cap->stubID);
+            write_varuint(byteout, cap->referrable);
         }
 
-        nStrings = matte_array_get_size(block->strings);
-        WRITE_BYTES(uint32_t, nStrings);
-        for(n = 0; n < nStrings; ++n) {
-            write_unistring(byteout, matte_array_at(block->strings, matteString_t *, n));
+        write_varuint(byteout, block->startingLine);
+
+        count = matte_array_get_size(block->instructions);
+        write_varuint(byteout, count);
+        matteBytecodeStubInstruction_t * insts = (matteBytecodeStubInstruction_t*)matte_array_get_data(block->instructions);
+        for(n = 0; n < count; ++n) {
+            uint64_t value = 0;
+            int kind = bytecode_operand_kind(insts+n, &value);
+            // the top 2 bits of the opcode byte hold the operand kind.
+            assert(insts[n].info.opcode < 64);
+            uint8_t op = insts[n].info.opcode | (kind << 6);
+            WRITE_BYTES(uint8_t, op);
+            if (kind == MATTE_BYTECODE_OPERAND__RAW) {
+                WRITE_BYTES(double, insts[n].data);
+            } else if (kind != MATTE_BYTECODE_OPERAND__ZERO) {
+                write_varuint(byteout, value);
+            }
         }
 
-
-        nCaps = matte_array_get_size(block->captures);
-        WRITE_BYTES(uint16_t, nCaps);
-        WRITE_NBYTES(nCaps * (sizeof(uint32_t) + sizeof(uint32_t)), matte_array_get_data(block->captures));
-
-        nInst = matte_array_get_size(block->instructions);
-        WRITE_BYTES(uint32_t, nInst);
-
-        WRITE_BYTES(uint32_t, block->startingLine);
-
-        for(n = 0; n < nInst; ++n) {
-            matteBytecodeStubInstruction_t * inst = &matte_array_at(block->instructions, matteBytecodeStubInstruction_t, n);
-            WRITE_BYTES(uint16_t, inst->info.lineOffset);
-            WRITE_BYTES(uint8_t, inst->info.opcode);
-            WRITE_BYTES(double, inst->data);        
+        // line table: runs of instructions that share a line offset.
+        n = 0;
+        while(n < count) {
+            uint32_t run = 1;
+            while(n+run < count && insts[n+run].info.lineOffset == insts[n].info.lineOffset) run++;
+            write_varuint(byteout, run);
+            write_varuint(byteout, insts[n].info.lineOffset);
+            n += run;
         }
 
         function_block_destroy(block);
@@ -5087,7 +6255,10 @@ void * matte_function_block_array_to_bytecode(
     uint8_t * out = (uint8_t*)matte_allocate(*size);
     memcpy(out, matte_array_get_data(byteout), *size);
 
+    matte_table_destroy(poolIndex);
+    matte_array_destroy(pool);
     matte_array_destroy(byteout);
+    matte_array_destroy(captured);
     matte_array_destroy(arr);
     return out;
 }
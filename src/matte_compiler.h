@@ -86,6 +86,37 @@ uint8_t * matte_compiler_run_with_named_references(
 
 
 
+/// Sets whether compiled code is optimized. When enabled, 
+/// functions called as soon as they are made (such as ::<= {} blocks)
+/// are compiled into the function that makes them,
+/// operations on constants are computed at compile time, 
+/// branches on constant conditions are resolved, 
+/// unreachable code is removed, and common opcode sequences 
+/// are marked with superinstructions. Enabled by default.
+void matte_compiler_enable_optimization(
+    /// Whether to optimize.
+    int enabled
+);
+
+/// Sets whether the compiler emits register-form instructions.
+/// When enabled, statements that only combine referrables and 
+/// small constants into a referrable are emitted as single 
+/// three-address instructions that work on the function's 
+/// referrable slots instead of the value stack. 
+/// Enabled by default.
+void matte_compiler_enable_register_form(
+    /// Whether to emit register-form instructions.
+    int enabled
+);
+
+/// Returns a number identifying the code the compiler 
+/// currently produces. It changes with the compiler's 
+/// revision, with the size of the VM's ext call table and 
+/// with the options set above, so bytecode saved along 
+/// with it can be checked for staleness.
+uint32_t matte_compiler_get_version();
+
+
 /// Attempts to take the given source and do the first step of 
 /// compilation and print the results. This is useful for debugging.
 /// but not much else.
@@ -0,0 +1,185 @@
+/*
+Copyright (c) 2020, Johnathan Corkery. (jcorkery@umich.edu)
+All rights reserved.
+
+This file is part of the Matte project (https://github.com/jcorks/matte)
+matte was released under the MIT License, as detailed below.
+
+
+
+Permission is hereby granted, free of charge, to any person obtaining a copy 
+of this software and associated documentation files (the "Software"), to deal 
+in the Software without restriction, including without limitation the rights 
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+copies of the Software, and to permit persons to whom the Software is furnished 
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall
+be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+DEALINGS IN THE SOFTWARE.
+
+
+*/
+#include "matte_format.h"
+#include "matte_string.h"
+#include "matte_array.h"
+#include "matte.h"
+#include <limits.h>
+
+
+
+typedef struct {
+    // The item to insert, or -1 for literal text.
+    int index;
+    
+    // For literals, the text itself. For slots, 
+    // the original text, used if the item does not exist.
+    matteString_t * text;
+} matteFormatSegment_t;
+
+
+struct matteFormat_t {
+    // all matteFormatSegment_t
+    matteArray_t * segments;
+};
+
+
+
+
+static int is_space(uint32_t c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+static int is_digit(uint32_t c) {
+    return c >= '0' && c <= '9';
+}
+
+static uint32_t count_digits(int val) {
+    uint32_t count = 1;
+    while(val >= 10) {
+        val /= 10;
+        count++;
+    }
+    return count;
+}
+
+
+// Reads a slot index after the '%' at position "at", in the 
+// same manner as sscanf("%d"). Returns the number of characters 
+// the slot takes up (including the '%') or 0 if there is no slot.
+static uint32_t read_slot(const matteString_t * src, uint32_t at, int * index) {
+    uint32_t len = matte_string_get_length(src);
+    uint32_t i = at + 1;
+    while(i < len && is_space(matte_string_get_char(src, i))) i++;
+    
+    int sign = 1;
+    if (i < len && (matte_string_get_char(src, i) == '-' || matte_string_get_char(src, i) == '+')) {
+        if (matte_string_get_char(src, i) == '-') sign = -1;
+        i++;
+    }
+    
+    if (i >= len || !is_digit(matte_string_get_char(src, i))) return 0;
+    
+    int value = 0;
+    for(; i < len && is_digit(matte_string_get_char(src, i)); ++i) {
+        int digit = matte_string_get_char(src, i) - '0';
+        if (value > (INT_MAX - digit) / 10) 
+            value = INT_MAX;
+        else
+            value = value*10 + digit;
+    }
+    
+    value *= sign;
+    if (value < 0) return 0;
+    *index = value;
+    // the slot covers the '%' and as many characters 
+    // as the index has digits.
+    return 1 + count_digits(value);
+}
+
+static matteString_t * last_literal(matteArray_t * segments) {
+    uint32_t len = matte_array_get_size(segments);
+    if (len && matte_array_at(segments, matteFormatSegment_t, len-1).index < 0)
+        return matte_array_at(segments, matteFormatSegment_t, len-1).text;
+
+    matteFormatSegment_t seg;
+    seg.index = -1;
+    seg.text = matte_string_create();
+    matte_array_push(segments, seg);
+    return seg.text;
+}
+
+
+matteFormat_t * matte_format_create(const matteString_t * src) {
+    matteFormat_t * format = (matteFormat_t*)matte_allocate(sizeof(matteFormat_t));
+    format->segments = matte_array_create(sizeof(matteFormatSegment_t));
+    
+    uint32_t len = matte_string_get_length(src);
+    uint32_t i = 0;
+    while(i < len) {
+        uint32_t c = matte_string_get_char(src, i);
+        if (c != '%' || i == len-1) {
+            matte_string_append_char(last_literal(format->segments), c);
+            i++;
+            continue;
+        }
+        
+        if (matte_string_get_char(src, i+1) == '%') {
+            matte_string_append_char(last_literal(format->segments), '%');
+            i += 2;
+            continue;
+        }
+        
+        int index;
+        uint32_t slotLen = read_slot(src, i, &index);
+        if (!slotLen) {
+            matte_string_append_char(last_literal(format->segments), c);
+            i++;
+            continue;
+        }
+        
+        matteFormatSegment_t seg;
+        seg.index = index;
+        seg.text = matte_string_clone(matte_string_get_substr(src, i, i+slotLen-1));
+        matte_array_push(format->segments, seg);
+        i += slotLen;
+    }
+    return format;
+}
+
+void matte_format_destroy(matteFormat_t * format) {
+    uint32_t i;
+    uint32_t len = matte_array_get_size(format->segments);
+    for(i = 0; i < len; ++i) {
+        matte_string_destroy(matte_array_at(format->segments, matteFormatSegment_t, i).text);
+    }
+    matte_array_destroy(format->segments);
+    matte_deallocate(format);
+}
+
+void matte_format_render(
+    const matteFormat_t * format,
+    const matteString_t ** items,
+    uint32_t itemCount,
+    matteString_t * output
+) {
+    matte_string_clear(output);
+
+    uint32_t i;
+    uint32_t len = matte_array_get_size(format->segments);
+    for(i = 0; i < len; ++i) {
+        matteFormatSegment_t * seg = &matte_array_at(format->segments, matteFormatSegment_t, i);
+        if (seg->index >= 0 && (uint32_t)seg->index < itemCount) {
+            matte_string_concat(output, items[seg->index]);
+        } else {
+            matte_string_concat(output, seg->text);
+        }
+    }
+}
@@ -0,0 +1,84 @@
+/*
+Copyright (c) 2020, Johnathan Corkery. (jcorkery@umich.edu)
+All rights reserved.
+
+This file is part of the Matte project (https://github.com/jcorks/matte)
+matte was released under the MIT License, as detailed below.
+
+
+
+Permission is hereby granted, free of charge, to any person obtaining a copy 
+of this software and associated documentation files (the "Software"), to deal 
+in the Software without restriction, including without limitation the rights 
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+copies of the Software, and to permit persons to whom the Software is furnished 
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall
+be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+DEALINGS IN THE SOFTWARE.
+
+
+*/
+
+
+#ifndef H_MATTE__FORMAT__INCLUDED
+#define H_MATTE__FORMAT__INCLUDED
+
+#include <stdint.h>
+
+typedef struct matteString_t matteString_t;
+
+
+/// A format string for the format query that has been 
+/// split into literal text and item slots, so that it 
+/// can be rendered many times without being re-read.
+///
+/// Within a format string, "%%" is a literal "%" and 
+/// "%" followed by a number N is replaced with item N.
+/// Slots whose item does not exist are left as-is.
+///
+typedef struct matteFormat_t matteFormat_t;
+
+
+/// Reads the given format string into a new format.
+///
+matteFormat_t * matte_format_create(
+    /// The format string to read.
+    const matteString_t * src
+);
+
+/// Frees the given format.
+///
+void matte_format_destroy(
+    /// The format to destroy.
+    matteFormat_t * format
+);
+
+/// Writes the format with the given items into 
+/// the output string, replacing its contents. 
+///
+void matte_format_render(
+    /// The format to render.
+    const matteFormat_t * format,
+    
+    /// The items to use, where the slot number is 
+    /// the index into this array.
+    const matteString_t ** items,
+    
+    /// The number of items.
+    uint32_t itemCount,
+    
+    /// The string to write into.
+    matteString_t * output
+);
+
+
+#endif
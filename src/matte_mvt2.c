@@ -80,6 +80,9 @@ struct matteMVT2_t {
     matteMVT2Bucket_t * buckets;
     
     uint32_t bucketsFilled;
+    
+    // changes whenever keys are added or removed
+    uint32_t version;
 };
 
 
@@ -220,6 +223,7 @@ matteValue_t * matte_mvt2_insert(matteMVT2_t * t, matteValue_t key, matteValue_t
         t->bucketsFilled ++;
 
     t->size++;
+    t->version++;
     return &bucket_add(src, entry)->value;
 }
 
@@ -256,6 +260,7 @@ void matte_mvt2_remove(matteMVT2_t * t, matteValue_t key) {
         if (next->key == key.value.id && next->binID == key.binIDreserved) {
             bucket_remove(bucket, i);
             t->size--;
+            t->version++;
             return;
         }
     }    
@@ -280,6 +285,7 @@ void matte_mvt2_clear(matteMVT2_t * t) {
         src->size = 0;
         src->alloc = 0;
     }
+    t->version++;
 }
 
 void matte_mvt2_get_all_keys(const matteMVT2_t * t, matteArray_t * arr) {
@@ -344,12 +350,32 @@ void matte_mvt2_get_all_values(const matteMVT2_t * t, matteArray_t * arr) {
 }
 
 
+void matte_mvt2_iter_start(matteMVT2Iter_t * iter, const matteMVT2_t * t) {
+    iter->mvt2 = t;
+    iter->bucket = 0;
+    iter->entry = 0;
+    iter->version = t->version;
+}
 
+int matte_mvt2_iter_next(matteMVT2Iter_t * iter, matteValue_t * key, matteValue_t ** value) {
+    const matteMVT2_t * t = iter->mvt2;
+    if (iter->version != t->version) return 0;
+    
+    while(iter->bucket < t->nBuckets) {
+        matteMVT2Bucket_t * bucket = t->buckets+iter->bucket;
+        if (iter->entry < bucket->size) {
+            matteMVT2Entry_t * next = bucket->entries+iter->entry++;
+            key->binIDreserved = next->binID;
+            key->value.id = next->key;
+            *value = &next->value;
+            return 1;
+        }
+        iter->bucket++;
+        iter->entry = 0;
+    }
+    return 0;
+}
 
-
-
-
-
-
-
-
+int matte_mvt2_iter_is_valid(const matteMVT2Iter_t * iter) {
+    return iter->version == iter->mvt2->version;
+}
@@ -122,6 +122,51 @@ void matte_mvt2_get_all_values(
 int matte_mvt2_get_size(const matteMVT2_t * MVT2);
 
 
+/// Walks the key-value pairs of an MVT2 in place, in the same 
+/// order as matte_mvt2_get_all_keys(), without copying them out.
+/// Adding or removing keys invalidates the iterator; changing 
+/// the value of an existing key does not.
+typedef struct {
+    const matteMVT2_t * mvt2;
+    uint32_t bucket;
+    uint32_t entry;
+    uint32_t version;
+} matteMVT2Iter_t;
+
+/// Prepares an iterator at the start of the MVT2.
+///
+void matte_mvt2_iter_start(
+    /// The iterator to prepare.
+    matteMVT2Iter_t * iter,
+
+    /// The MVT2 to walk.
+    const matteMVT2_t * MVT2
+);
+
+/// Moves to the next key-value pair, setting key and value 
+/// to it. Returns 0 once there are no more pairs or if the 
+/// iterator was invalidated.
+///
+int matte_mvt2_iter_next(
+    /// The iterator to advance.
+    matteMVT2Iter_t * iter,
+
+    /// The key of the pair.
+    matteValue_t * key,
+
+    /// The value of the pair, which can be modified in place.
+    matteValue_t ** value
+);
+
+/// Returns whether the MVT2 has had keys added or removed 
+/// since the iterator was started.
+///
+int matte_mvt2_iter_is_valid(
+    /// The iterator to check.
+    const matteMVT2Iter_t * iter
+);
+
+
 
 /// Removes the key-value pair from the MVT2 whose key matches 
 /// the one given. If no such pair exists, no action is taken.
@@ -0,0 +1,501 @@
+/*
+Copyright (c) 2020, Johnathan Corkery. (jcorkery@umich.edu)
+All rights reserved.
+
+This file is part of the Matte project (https://github.com/jcorks/matte)
+matte was released under the MIT License, as detailed below.
+
+
+
+Permission is hereby granted, free of charge, to any person obtaining a copy 
+of this software and associated documentation files (the "Software"), to deal 
+in the Software without restriction, including without limitation the rights 
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+copies of the Software, and to permit persons to whom the Software is furnished 
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall
+be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+DEALINGS IN THE SOFTWARE.
+
+
+*/
+
+#include "matte_number.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+
+
+
+////////////////////// Formatting
+//
+// Non-integral numbers are formatted using Grisu2 (Loitsch, 
+// "Printing Floating-Point Numbers Quickly and Accurately with 
+// Integers"), which finds the digits using only 64-bit integer math.
+// Its output always reads back as the same number and is 
+// the shortest such output for nearly all values.
+
+typedef struct {
+    uint64_t f;
+    int e;
+} matteDiyFp_t;
+
+#define DOUBLE_SIGNIFICAND_SIZE 52
+#define DOUBLE_EXPONENT_BIAS (0x3FF + DOUBLE_SIGNIFICAND_SIZE)
+#define DOUBLE_HIDDEN_BIT 0x0010000000000000ull
+#define DOUBLE_SIGNIFICAND_MASK 0x000FFFFFFFFFFFFFull
+#define DOUBLE_EXPONENT_MASK 0x7FF0000000000000ull
+
+
+// Cached powers of 10 from 10^-348 to 10^340 in steps of 8,
+// normalized so that the highest bit of the significand is set.
+static const uint64_t cached_powers_f[] = {
+    0xfa8fd5a0081c0288ull, 0xbaaee17fa23ebf76ull, 0x8b16fb203055ac76ull,
+    0xcf42894a5dce35eaull, 0x9a6bb0aa55653b2dull, 0xe61acf033d1a45dfull,
+    0xab70fe17c79ac6caull, 0xff77b1fcbebcdc4full, 0xbe5691ef416bd60cull,
+    0x8dd01fad907ffc3cull, 0xd3515c2831559a83ull, 0x9d71ac8fada6c9b5ull,
+    0xea9c227723ee8bcbull, 0xaecc49914078536dull, 0x823c12795db6ce57ull,
+    0xc21094364dfb5637ull, 0x9096ea6f3848984full, 0xd77485cb25823ac7ull,
+    0xa086cfcd97bf97f4ull, 0xef340a98172aace5ull, 0xb23867fb2a35b28eull,
+    0x84c8d4dfd2c63f3bull, 0xc5dd44271ad3cdbaull, 0x936b9fcebb25c996ull,
+    0xdbac6c247d62a584ull, 0xa3ab66580d5fdaf6ull, 0xf3e2f893dec3f126ull,
+    0xb5b5ada8aaff80b8ull, 0x87625f056c7c4a8bull, 0xc9bcff6034c13053ull,
+    0x964e858c91ba2655ull, 0xdff9772470297ebdull, 0xa6dfbd9fb8e5b88full,
+    0xf8a95fcf88747d94ull, 0xb94470938fa89bcfull, 0x8a08f0f8bf0f156bull,
+    0xcdb02555653131b6ull, 0x993fe2c6d07b7facull, 0xe45c10c42a2b3b06ull,
+    0xaa242499697392d3ull, 0xfd87b5f28300ca0eull, 0xbce5086492111aebull,
+    0x8cbccc096f5088ccull, 0xd1b71758e219652cull, 0x9c40000000000000ull,
+    0xe8d4a51000000000ull, 0xad78ebc5ac620000ull, 0x813f3978f8940984ull,
+    0xc097ce7bc90715b3ull, 0x8f7e32ce7bea5c70ull, 0xd5d238a4abe98068ull,
+    0x9f4f2726179a2245ull, 0xed63a231d4c4fb27ull, 0xb0de65388cc8ada8ull,
+    0x83c7088e1aab65dbull, 0xc45d1df942711d9aull, 0x924d692ca61be758ull,
+    0xda01ee641a708deaull, 0xa26da3999aef774aull, 0xf209787bb47d6b85ull,
+    0xb454e4a179dd1877ull, 0x865b86925b9bc5c2ull, 0xc83553c5c8965d3dull,
+    0x952ab45cfa97a0b3ull, 0xde469fbd99a05fe3ull, 0xa59bc234db398c25ull,
+    0xf6c69a72a3989f5cull, 0xb7dcbf5354e9beceull, 0x88fcf317f22241e2ull,
+    0xcc20ce9bd35c78a5ull, 0x98165af37b2153dfull, 0xe2a0b5dc971f303aull,
+    0xa8d9d1535ce3b396ull, 0xfb9b7cd9a4a7443cull, 0xbb764c4ca7a44410ull,
+    0x8bab8eefb6409c1aull, 0xd01fef10a657842cull, 0x9b10a4e5e9913129ull,
+    0xe7109bfba19c0c9dull, 0xac2820d9623bf429ull, 0x80444b5e7aa7cf85ull,
+    0xbf21e44003acdd2dull, 0x8e679c2f5e44ff8full, 0xd433179d9c8cb841ull,
+    0x9e19db92b4e31ba9ull, 0xeb96bf6ebadf77d9ull, 0xaf87023b9bf0ee6bull,
+};
+
+static const int16_t cached_powers_e[] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980,
+    -954, -927, -901, -874, -847, -821, -794, -768, -741, -715,
+    -688, -661, -635, -608, -582, -555, -529, -502, -475, -449,
+    -422, -396, -369, -343, -316, -289, -263, -236, -210, -183,
+    -157, -130, -103, -77, -50, -24, 3, 30, 56, 83,
+    109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+    375, 402, 428, 455, 481, 508, 534, 561, 588, 614,
+    641, 667, 694, 720, 747, 774, 800, 827, 853, 880,
+    907, 933, 960, 986, 1013, 1039, 1066,
+};
+
+static const uint64_t pow10_u64[] = {
+    1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull, 
+    100000000ull, 1000000000ull, 10000000000ull, 100000000000ull, 1000000000000ull,
+    10000000000000ull, 100000000000000ull, 1000000000000000ull, 10000000000000000ull, 
+    100000000000000000ull, 1000000000000000000ull, 10000000000000000000ull
+};
+
+
+static matteDiyFp_t diyfp_from_double(double d) {
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(double));
+    matteDiyFp_t out;
+    int biasedE = (int)((bits & DOUBLE_EXPONENT_MASK) >> DOUBLE_SIGNIFICAND_SIZE);
+    uint64_t significand = bits & DOUBLE_SIGNIFICAND_MASK;
+    if (biasedE) {
+        out.f = significand + DOUBLE_HIDDEN_BIT;
+        out.e = biasedE - DOUBLE_EXPONENT_BIAS;
+    } else {
+        out.f = significand;
+        out.e = 1 - DOUBLE_EXPONENT_BIAS;
+    }
+    return out;
+}
+
+// rounded upper 64 bits of the 128-bit product
+static matteDiyFp_t diyfp_multiply(matteDiyFp_t a, matteDiyFp_t b) {
+    const uint64_t M32 = 0xFFFFFFFFull;
+    uint64_t ah = a.f >> 32;
+    uint64_t al = a.f & M32;
+    uint64_t bh = b.f >> 32;
+    uint64_t bl = b.f & M32;
+    uint64_t hh = ah * bh;
+    uint64_t lh = al * bh;
+    uint64_t hl = ah * bl;
+    uint64_t ll = al * bl;
+    uint64_t tmp = (ll >> 32) + (hl & M32) + (lh & M32);
+    tmp += 1ull << 31;
+    matteDiyFp_t out;
+    out.f = hh + (hl >> 32) + (lh >> 32) + (tmp >> 32);
+    out.e = a.e + b.e + 64;
+    return out;
+}
+
+static matteDiyFp_t diyfp_normalize(matteDiyFp_t a) {
+    while(!(a.f & (1ull << 63))) {
+        a.f <<= 1;
+        a.e--;
+    }
+    return a;
+}
+
+// Gets the normalized boundaries of the rounding interval of v.
+// When reduced, v's lowest significand bit is treated as unused, 
+// so the interval also covers the double just above v.
+static void diyfp_boundaries(matteDiyFp_t v, int reduced, matteDiyFp_t * minus, matteDiyFp_t * plus) {
+    matteDiyFp_t pl;
+    pl.f = (v.f << 1) + (reduced ? 3 : 1);
+    pl.e = v.e - 1;
+    while(!(pl.f & (DOUBLE_HIDDEN_BIT << 1))) {
+        pl.f <<= 1;
+        pl.e--;
+    }
+    pl.f <<= 64 - DOUBLE_SIGNIFICAND_SIZE - 2;
+    pl.e -= 64 - DOUBLE_SIGNIFICAND_SIZE - 2;
+    
+    matteDiyFp_t mi;
+    if (v.f == DOUBLE_HIDDEN_BIT) {
+        mi.f = (v.f << 2) - 1;
+        mi.e = v.e - 2;
+    } else {
+        mi.f = (v.f << 1) - 1;
+        mi.e = v.e - 1;
+    }
+    mi.f <<= mi.e - pl.e;
+    mi.e = pl.e;
+    *minus = mi;
+    *plus = pl;
+}
+
+// Gets a cached power c such that multiplying a number with 
+// binary exponent e by c brings its exponent into [-60, -32].
+// K is set to the negated decimal exponent of c.
+static matteDiyFp_t get_cached_power(int e, int * K) {
+    double dk = (-61 - e) * 0.30102999566398114 + 347;
+    int k = (int)dk;
+    if (dk - k > 0.0) k++;
+    
+    uint32_t index = (uint32_t)((k >> 3) + 1);
+    *K = -(-348 + (int)(index * 8));
+    matteDiyFp_t out;
+    out.f = cached_powers_f[index];
+    out.e = cached_powers_e[index];
+    return out;
+}
+
+static void grisu_round(char * buffer, int len, uint64_t delta, uint64_t rest, uint64_t tenKappa, uint64_t wpw) {
+    while(rest < wpw && delta - rest >= tenKappa &&
+        (rest + tenKappa < wpw || wpw - rest > rest + tenKappa - wpw)) {
+        buffer[len-1]--;
+        rest += tenKappa;
+    }
+}
+
+static int count_decimal_digits(uint32_t n) {
+    int count = 1;
+    while(n >= 10) {
+        n /= 10;
+        count++;
+    }
+    return count;
+}
+
+static void digit_gen(matteDiyFp_t W, matteDiyFp_t Mp, uint64_t delta, char * buffer, int * len, int * K) {
+    matteDiyFp_t one;
+    one.f = 1ull << -Mp.e;
+    one.e = Mp.e;
+    uint64_t wpw = Mp.f - W.f;
+    uint32_t p1 = (uint32_t)(Mp.f >> -one.e);
+    uint64_t p2 = Mp.f & (one.f - 1);
+    int kappa = count_decimal_digits(p1);
+    *len = 0;
+    
+    while(kappa > 0) {
+        uint32_t div = (uint32_t)pow10_u64[kappa-1];
+        uint32_t d = p1 / div;
+        p1 %= div;
+        if (d || *len)
+            buffer[(*len)++] = (char)('0' + d);
+        kappa--;
+        uint64_t tmp = ((uint64_t)p1 << -one.e) + p2;
+        if (tmp <= delta) {
+            *K += kappa;
+            grisu_round(buffer, *len, delta, tmp, pow10_u64[kappa] << -one.e, wpw);
+            return;
+        }
+    }
+    
+    for(;;) {
+        p2 *= 10;
+        delta *= 10;
+        char d = (char)(p2 >> -one.e);
+        if (d || *len)
+            buffer[(*len)++] = (char)('0' + d);
+        p2 &= one.f - 1;
+        kappa--;
+        if (p2 < delta) {
+            *K += kappa;
+            grisu_round(buffer, *len, delta, p2, one.f, -kappa < 20 ? wpw * pow10_u64[-kappa] : 0);
+            return;
+        }
+    }
+}
+
+// Writes the decimal digits of a positive, finite value.
+// The value is equal to digits * 10^K.
+static int grisu2(double value, int reduced, char * buffer, int * K) {
+    matteDiyFp_t v = diyfp_from_double(value);
+    matteDiyFp_t wm, wp;
+    diyfp_boundaries(v, reduced, &wm, &wp);
+    
+    // when reduced, aim for the middle of v and the double above it.
+    matteDiyFp_t w;
+    if (reduced) {
+        w.f = ((v.f << 1) + 1) << (v.e - 1 - wp.e);
+        w.e = wp.e;
+    } else {
+        w = diyfp_normalize(v);
+    }
+    
+    matteDiyFp_t cmk = get_cached_power(wp.e, K);
+    matteDiyFp_t W  = diyfp_multiply(w, cmk);
+    matteDiyFp_t Wp = diyfp_multiply(wp, cmk);
+    matteDiyFp_t Wm = diyfp_multiply(wm, cmk);
+    Wm.f++;
+    Wp.f--;
+    int len;
+    digit_gen(W, Wp, Wp.f - Wm.f, buffer, &len, K);
+    return len;
+}
+
+static int write_exponent(int exponent, char * buffer) {
+    char * iter = buffer;
+    *(iter++) = 'e';
+    if (exponent < 0) {
+        *(iter++) = '-';
+        exponent = -exponent;
+    } else {
+        *(iter++) = '+';
+    }
+    if (exponent >= 100) {
+        *(iter++) = (char)('0' + exponent / 100);
+        exponent %= 100;
+    }
+    *(iter++) = (char)('0' + exponent / 10);
+    *(iter++) = (char)('0' + exponent % 10);
+    return (int)(iter - buffer);
+}
+
+static int write_integer(uint64_t value, char * buffer) {
+    char digits[20];
+    int count = 0;
+    do {
+        digits[count++] = (char)('0' + value % 10);
+        value /= 10;
+    } while(value);
+    
+    int i;
+    for(i = 0; i < count; ++i) 
+        buffer[i] = digits[count-1-i];
+    return count;
+}
+
+
+static int number_to_c_str(double value, int reduced, char * buffer) {
+    char * iter = buffer;
+    if (isnan(value)) {
+        memcpy(buffer, "nan", 4);
+        return 3;
+    }
+    if (signbit(value) && value != 0) {
+        *(iter++) = '-';
+        value = -value;
+    }
+    if (isinf(value)) {
+        memcpy(iter, "inf", 4);
+        return (int)(iter - buffer) + 3;
+    }
+
+    // whole numbers (and those very close to 0) are written in full.
+    if (value < 9223372036854775808.0 && fabs(value - (int64_t)value) < DBL_EPSILON) {
+        if (value < 1) iter = buffer; // no "-0"
+        iter += write_integer((uint64_t)value, iter);
+        *iter = 0;
+        return (int)(iter - buffer);
+    }
+
+    char digits[24];
+    int K;
+    int len = grisu2(value, reduced, digits, &K);
+    // decimal exponent of the first digit
+    int exponent = K + len - 1;
+    
+    // same choice of notation as printf("%.15g")
+    if (exponent < -4 || exponent >= 15) {
+        *(iter++) = digits[0];
+        if (len > 1) {
+            *(iter++) = '.';
+            memcpy(iter, digits+1, len-1);
+            iter += len-1;
+        }
+        iter += write_exponent(exponent, iter);
+    } else if (exponent < 0) {
+        *(iter++) = '0';
+        *(iter++) = '.';
+        int i;
+        for(i = exponent+1; i < 0; ++i)
+            *(iter++) = '0';
+        memcpy(iter, digits, len);
+        iter += len;
+    } else if (len <= exponent+1) {
+        memcpy(iter, digits, len);
+        iter += len;
+        int i;
+        for(i = len; i <= exponent; ++i)
+            *(iter++) = '0';
+    } else {
+        memcpy(iter, digits, exponent+1);
+        iter += exponent+1;
+        *(iter++) = '.';
+        memcpy(iter, digits+exponent+1, len-(exponent+1));
+        iter += len-(exponent+1);
+    }
+    *iter = 0;
+    return (int)(iter - buffer);
+}
+
+int matte_number_to_c_str(double value, char * buffer) {
+    return number_to_c_str(value, 0, buffer);
+}
+
+int matte_number_value_to_c_str(double value, char * buffer) {
+    return number_to_c_str(value, 1, buffer);
+}
+
+
+
+
+////////////////////// Parsing
+//
+// Plain decimal input whose digits fit within a double's 
+// significand and whose exponent is small is read exactly with 
+// a single multiplication or division (Clinger's fast path).
+// Anything else is left to strtod().
+
+#define MAX_EXACT_INTEGER 9007199254740992ull // 2^53
+
+static const double pow10_exact[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static int is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static int number_from_c_str_libc(const char * str, double * value) {
+    char * end;
+    double out = strtod(str, &end);
+    if (end == str) return 0;
+    *value = out;
+    return 1;
+}
+
+int matte_number_from_c_str(const char * str, double * value) {
+    const char * iter = str;
+    while(*iter == ' ' || (*iter >= '\t' && *iter <= '\r')) iter++;
+    
+    int negative = 0;
+    if (*iter == '-' || *iter == '+') {
+        negative = *iter == '-';
+        iter++;
+    }
+    
+    uint64_t mantissa = 0;
+    int significantDigits = 0;
+    int exponent = 0;
+    int anyDigits = 0;
+    
+    // hex and other special forms
+    if (iter[0] == '0' && (iter[1] == 'x' || iter[1] == 'X'))
+        return number_from_c_str_libc(str, value);
+
+    for(; is_digit(*iter); ++iter) {
+        anyDigits = 1;
+        if (!significantDigits && *iter == '0') continue;
+        if (significantDigits == 19)
+            return number_from_c_str_libc(str, value);
+        mantissa = mantissa * 10 + (*iter - '0');
+        significantDigits++;
+    }
+    
+    if (*iter == '.') {
+        iter++;
+        for(; is_digit(*iter); ++iter) {
+            anyDigits = 1;
+            exponent--;
+            if (!significantDigits && *iter == '0') continue;
+            if (significantDigits == 19)
+                return number_from_c_str_libc(str, value);
+            mantissa = mantissa * 10 + (*iter - '0');
+            significantDigits++;
+        }
+    }
+
+    // inf, nan, etc.
+    if (!anyDigits) 
+        return number_from_c_str_libc(str, value);
+        
+    if (*iter == 'e' || *iter == 'E') {
+        const char * expIter = iter+1;
+        int expNegative = 0;
+        if (*expIter == '-' || *expIter == '+') {
+            expNegative = *expIter == '-';
+            expIter++;
+        }
+        if (is_digit(*expIter)) {
+            int exp = 0;
+            for(; is_digit(*expIter); ++expIter) {
+                if (exp < 10000) exp = exp * 10 + (*expIter - '0');
+            }
+            exponent += expNegative ? -exp : exp;
+        }
+    }
+    
+    double out;
+    if (mantissa == 0) {
+        out = 0.0;
+    } else {
+        // move extra powers of 10 into the mantissa while it stays exact
+        while(exponent > 22 && mantissa <= MAX_EXACT_INTEGER / 10) {
+            mantissa *= 10;
+            exponent--;
+        }
+        if (mantissa > MAX_EXACT_INTEGER || exponent > 22 || exponent < -22)
+            return number_from_c_str_libc(str, value);
+
+        out = (double)mantissa;
+        if (exponent < 0) 
+            out /= pow10_exact[-exponent];
+        else 
+            out *= pow10_exact[exponent];
+    }
+
+    *value = negative ? -out : out;
+    return 1;
+}
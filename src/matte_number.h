@@ -0,0 +1,94 @@
+/*
+Copyright (c) 2020, Johnathan Corkery. (jcorkery@umich.edu)
+All rights reserved.
+
+This file is part of the Matte project (https://github.com/jcorks/matte)
+matte was released under the MIT License, as detailed below.
+
+
+
+Permission is hereby granted, free of charge, to any person obtaining a copy 
+of this software and associated documentation files (the "Software"), to deal 
+in the Software without restriction, including without limitation the rights 
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+copies of the Software, and to permit persons to whom the Software is furnished 
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall
+be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+DEALINGS IN THE SOFTWARE.
+
+
+*/
+
+
+#ifndef H_MATTE__NUMBER__INCLUDED
+#define H_MATTE__NUMBER__INCLUDED
+
+
+#include <stdint.h>
+
+
+/// The size of a buffer that is always large enough to 
+/// hold the output of matte_number_to_c_str(), including 
+/// the terminating null.
+#define MATTE_NUMBER_C_STR_MAX 32
+
+
+/// Writes the given number as a C-string into the given buffer,
+/// which must be at least MATTE_NUMBER_C_STR_MAX bytes.
+///
+/// Integral values are written in full. Other values are written 
+/// with the fewest digits that read back as the same number, 
+/// switching to exponent notation (i.e. 1.5e-07) for very small 
+/// or large magnitudes. The number of characters written,
+/// not including the terminating null, is returned.
+///
+int matte_number_to_c_str(
+    /// The number to write.
+    double value,
+    
+    /// The buffer to write to.
+    char * buffer
+);
+
+
+/// Same as matte_number_to_c_str(), but for numbers held 
+/// by a matteValue_t, where the lowest bit of the significand 
+/// is reserved. The output is the shortest that reads back 
+/// as the same Number value, which is often shorter than 
+/// the output for the raw double.
+///
+int matte_number_value_to_c_str(
+    /// The number to write.
+    double value,
+    
+    /// The buffer to write to.
+    char * buffer
+);
+
+
+/// Reads a number from the start of the given C-string, 
+/// ignoring leading whitespace and any trailing content.
+/// Accepts the same input as strtod(), and most 
+/// plain decimal input is read without going through the C library.
+/// Returns 1 and sets the value on success, else 
+/// returns 0.
+///
+int matte_number_from_c_str(
+    /// The C-string to read.
+    const char * str,
+    
+    /// The read value.
+    double * value
+);
+
+
+#endif
@@ -169,7 +169,73 @@ typedef enum {
     
     // pushes the private interface data for the calling context if any.
     MATTE_OPCODE_PIP,
+
+
+    // Superinstructions.
+    // These are emitted by the compiler in place of the first
+    // opcode of a common sequence. The remaining instructions of
+    // the sequence are left as-is and are skipped over when the
+    // superinstruction runs, so jumps into the middle of
+    // a sequence still behave normally.
+
+    // PRF + NST + OLK: looks up a constant string key
+    // in a referrable.
+    MATTE_OPCODE_RSL,
+
+    // PRF + NNM + OPR: binary operator with a referrable
+    // and a constant number.
+    MATTE_OPCODE_RNO,
+
+    // OPR + ARF: operator whose result is assigned to
+    // a referrable.
+    MATTE_OPCODE_OAR,
+
+    // CPY + POP: copy the top and immediately pop values.
+    MATTE_OPCODE_CPP,
+
+    // ARF + POP: assignment to a referrable whose result 
+    // is discarded.
+    MATTE_OPCODE_ARP,
+
+
+    // Register form.
+    // These work directly on the referrable slots of the current 
+    // frame and leave the value stack untouched. Their operands are 
+    // stored in the instruction's args:
+    //  slot0 -> operation, with operand kinds in the high byte
+    //  slot1 -> destination referrable
+    //  slot2 -> first operand 
+    //  slot3 -> second operand
+    // An operand is a referrable, or a small integer constant when 
+    // its kind bit is set (bit 8 for slot2, bit 9 for slot3).
     
+    // dst = slot2 (binary operator) slot3
+    MATTE_OPCODE_ROP,
+    
+    // dst = slot2 member lookup of the stub string slot3.
+    // slot0 is whether the lookup is a bracket lookup.
+    MATTE_OPCODE_RLK,
+    
+    // dst (assignment operator) slot2. The assignment operator 
+    // is relative to MATTE_OPERATOR_ASSIGNMENT_NONE.
+    MATTE_OPCODE_RAS,
+
+
+    // Number-only operators.
+    // Emitted in place of OPR when both operands are known to be 
+    // numbers. The data is still the operator, and if either 
+    // operand turns out not to be a number, the opcode acts as OPR.
+    MATTE_OPCODE_NAD, // +
+    MATTE_OPCODE_NSB, // -
+    MATTE_OPCODE_NML, // *
+    MATTE_OPCODE_NDV, // /
+    MATTE_OPCODE_NLT, // <
+    MATTE_OPCODE_NGT, // >
+    MATTE_OPCODE_NLE, // <=
+    MATTE_OPCODE_NGE, // >=
+    MATTE_OPCODE_NEQ, // ==
+    MATTE_OPCODE_NNE, // !=
+
     MATTE_OPCODE_ERROR = -1
 
 } matteOpcode_t;
@@ -252,6 +318,7 @@ typedef enum {
     MATTE_EXT_CALL__NUMBER__PI,    
     MATTE_EXT_CALL__NUMBER__PARSE,
     MATTE_EXT_CALL__NUMBER__RANDOM,
+    MATTE_EXT_CALL__NUMBER__SEED,
 
 
     MATTE_EXT_CALL__STRING__COMBINE,
@@ -262,6 +329,7 @@ typedef enum {
     MATTE_EXT_CALL__OBJECT__FREEZEGC,
     MATTE_EXT_CALL__OBJECT__THAWGC,
     MATTE_EXT_CALL__OBJECT__GARBAGECOLLECT,
+    MATTE_EXT_CALL__OBJECT__FREEZE,
 
 
     MATTE_EXT_CALL__QUERY__ATAN2,
@@ -38,11 +38,11 @@ DEALINGS IN THE SOFTWARE.
 #include "matte_store_string.h"
 #include "matte.h"
 #include "matte_mvt2.h"
+#include "matte_number.h"
 
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
-#include <time.h>
 #include <math.h>
 #include <float.h>
 #include <inttypes.h>
@@ -201,8 +201,6 @@ struct matteStore_t {
     // MatteTypeData
     matteArray_t * typecode2data;
     matteArray_t * external;
-    matteArray_t * kvIter_v;
-    matteArray_t * kvIter_k;
     matteArray_t * mgIter;
     matteArray_t * routePather;
     matteTableIter_t * routeIter;
@@ -227,6 +225,8 @@ struct matteStore_t {
     matteValue_t specialString_false;
     matteValue_t specialString_key;
     matteValue_t specialString_value;
+    matteValue_t specialString_a;
+    matteValue_t specialString_b;
     matteValue_t specialString_dynamicBindToken;
     
     
@@ -262,6 +262,9 @@ struct matteStore_t {
     matteObjectNode_t * roots;
     double ticksGC;
 
+    // ids of all frozen objects, released when the store is destroyed.
+    matteArray_t * frozen;
+
     
     #ifdef MATTE_DEBUG__STORE 
         uint64_t gcCycles;
@@ -292,7 +295,23 @@ enum {
     // Records.... 
     // - have a static set of string-only keys that are set before setting as a record.
     // - Can only have string key read / writes
-    OBJECT_STATE__HAS_LAYOUT = 4
+    OBJECT_STATE__HAS_LAYOUT = 4,
+    
+    // Whether the object's key-value containers are shared 
+    // with other objects after a copy-on-write clone. Shared 
+    // containers are read in place and copied on the first write.
+    OBJECT_STATE__SHARED_STORAGE = 8,
+    
+    // Whether the object is the hidden owner of shared containers.
+    // It holds the GC edges to their contents and is a child of 
+    // every object sharing them.
+    OBJECT_STATE__IS_STORAGE = 16,
+    
+    // Whether the object is frozen. Frozen objects cannot be 
+    // modified and only refer to other frozen objects, so they 
+    // are kept out of the tricolor lists, never traced and never 
+    // collected until the store is destroyed.
+    OBJECT_STATE__FROZEN = 32
 };
 
 #define ENABLE_STATE(__o__, __s__) ((__o__)->state |= (__s__))
@@ -534,6 +553,8 @@ static matteValue_t * object_lookup(matteStore_t * store, matteObject_t * m, mat
 
 
 static void object_link_parent(matteStore_t * h, matteObject_t * parent, matteObject_t * child) {
+    // frozen objects are never collected, so no edges to them are kept.
+    if (QUERY_STATE(child, OBJECT_STATE__FROZEN)) return;
     #ifdef MATTE_DEBUG__STORE
         matteValue_t v;
         v.binIDreserved = MATTE_VALUE_TYPE_OBJECT;
@@ -570,6 +591,7 @@ static void object_link_parent(matteStore_t * h, matteObject_t * parent, matteOb
 
 static void object_unlink_parent(matteStore_t * h, matteObject_t * parent, matteObject_t * child) {
     if (child == NULL) return; // when? only when root check early refcount = 0 forced cleanup?
+    if (QUERY_STATE(child, OBJECT_STATE__FROZEN)) return;
 
 
     #ifdef MATTE_DEBUG__STORE
@@ -664,7 +686,163 @@ static void object_unlink_parent_value_(matteStore_t * store, matteObject_t * pa
 #endif
 
 
+// Objects with at least this many keys are cloned by sharing storage.
+// Smaller ones are cheaper to copy outright.
+#define OBJECT_SHARE_MIN_KEYS 16
+
+// Returns the hidden storage object of a sharing object.
+static matteObject_t * object_storage_find(matteStore_t * store, matteObject_t * m) {
+    matteObjectNode_t * next = m->children ? matte_pool_fetch(store->nodes, matteObjectNode_t, m->children) : NULL;
+    while(next) {
+        matteObject_t * child = next->data;
+        if (QUERY_STATE(child, OBJECT_STATE__IS_STORAGE)) return child;
+        next = next->next;
+    }
+    #ifdef MATTE_DEBUG
+        assert(!"Shared object has no storage.");
+    #endif
+    return NULL;
+}
+
+static void object_storage_link(matteStore_t * store, matteObject_t * m, matteObject_t * storage) {
+    matteValue_t sv = {};
+    sv.binIDreserved = MATTE_VALUE_TYPE_OBJECT;
+    sv.value.id = storage->storeID;
+    object_link_parent_value(store, m, &sv);
+    m->table.keyvalues_number = storage->table.keyvalues_number;
+    m->table.keyvalues_id = storage->table.keyvalues_id;
+    ENABLE_STATE(m, OBJECT_STATE__SHARED_STORAGE);
+}
+
+// Moves the containers of m and the GC edges to their contents 
+// into a new hidden storage object that m then shares. 
+// m must not have edges other than to its contents.
+static matteObject_t * object_storage_create(matteStore_t * store, matteObject_t * m) {
+    matteValue_t sv = matte_store_new_value(store);
+    matte_value_into_new_object_ref(store, &sv);
+    matteObject_t * storage = matte_store_bin_fetch_table(store->bin, sv.value.id);
+    ENABLE_STATE(storage, OBJECT_STATE__IS_STORAGE);
+
+    storage->table.keyvalues_number = m->table.keyvalues_number;
+    storage->table.keyvalues_id = m->table.keyvalues_id;
+    storage->children = m->children;
+    m->children = 0;
+    #ifdef MATTE_DEBUG__STORE
+    {
+        matteObjectNode_t * next = storage->children ? matte_pool_fetch(store->nodes, matteObjectNode_t, storage->children) : NULL;
+        while(next) {
+            matteObject_t * child = next->data;
+            uint32_t i;
+            for(i = 0; i < matte_array_get_size(child->parents); ++i) {
+                if (matte_array_at(child->parents, matteValue_t, i).value.id == m->storeID) {
+                    matte_array_at(child->parents, matteValue_t, i).value.id = storage->storeID;
+                    break;
+                }
+            }
+            next = next->next;
+        }
+    }
+    #endif
+
+    object_storage_link(store, m, storage);
+    return storage;
+}
+
+// Gives a sharing object its own copy of the shared containers 
+// so that it can be written to. The storage object is released 
+// by m and collected once nothing shares it.
+static void object_storage_detach(matteStore_t * store, matteObject_t * m) {
+    matteObject_t * storage = object_storage_find(store, m);
+    DISABLE_STATE(m, OBJECT_STATE__SHARED_STORAGE);
+    m->table.keyvalues_number = NULL;
+    m->table.keyvalues_id = NULL;
+    if (!storage) return;
+
+    if (storage->table.keyvalues_number) {
+        uint32_t i;
+        uint32_t len = matte_array_get_size(storage->table.keyvalues_number);
+        m->table.keyvalues_number = matte_array_create(sizeof(matteValue_t));
+        matte_array_reserve(m->table.keyvalues_number, len);
+        for(i = 0; i < len; ++i) {
+            matteValue_t val = matte_array_at(storage->table.keyvalues_number, matteValue_t, i);
+            matteValue_t out = matte_store_new_value(store);
+            matte_value_into_copy(store, &out, val);
+            if (matte_value_type(val) == MATTE_VALUE_TYPE_OBJECT) {
+                object_link_parent_value(store, m, &val);
+            }
+            matte_array_push(m->table.keyvalues_number, out);
+        }
+    }
+
+    if (storage->table.keyvalues_id) {
+        matteMVT2Iter_t iter;
+        matteValue_t key;
+        matteValue_t * value;
+        m->table.keyvalues_id = matte_mvt2_create();
+        matte_mvt2_iter_start(&iter, storage->table.keyvalues_id);
+        while(matte_mvt2_iter_next(&iter, &key, &value)) {
+            matteValue_t out = matte_store_new_value(store);
+            matte_value_into_copy(store, &out, *value);
+            if (matte_value_type(out) == MATTE_VALUE_TYPE_OBJECT) {
+                object_link_parent_value(store, m, &out);
+            }
+            switch(matte_value_type(key)) {
+              case MATTE_VALUE_TYPE_STRING:
+                matte_string_store_ref_id(store->stringStore, key.value.id);
+                break;
+              case MATTE_VALUE_TYPE_OBJECT:
+                object_link_parent_value(store, m, &key);
+                break;
+            }
+            matte_mvt2_insert(m->table.keyvalues_id, key, out);
+        }
+    }
+
+    matteValue_t sv = {};
+    sv.binIDreserved = MATTE_VALUE_TYPE_OBJECT;
+    sv.value.id = storage->storeID;
+    object_unlink_parent_value(store, m, &sv);
+}
+
+#define OBJECT_STORAGE_DETACH(__STORE__, __M__) if (QUERY_STATE(__M__, OBJECT_STATE__SHARED_STORAGE)) object_storage_detach(__STORE__, __M__);
+
+// Raises an error and returns 1 if m is frozen.
+static int object_frozen_error(matteStore_t * store, matteObject_t * m) {
+    if (!QUERY_STATE(m, OBJECT_STATE__FROZEN)) return 0;
+    matte_vm_raise_error_cstring(store->vm, "Cannot modify a frozen object.");
+    return 1;
+}
+
+
+// Appends a copy of val to the number keys of m, which must exist.
+static matteValue_t * object_array_push_fast(matteStore_t * store, matteObject_t * m, matteValue_t val) {
+    matteValue_t out = matte_store_new_value(store);
+    matte_value_into_copy(store, &out, val);
+    if (matte_value_type(val) == MATTE_VALUE_TYPE_OBJECT) {    
+        object_link_parent_value(store, m, &val);
+    }
+    matte_array_push(m->table.keyvalues_number, out);
+    return &matte_array_at(m->table.keyvalues_number, matteValue_t, matte_array_get_size(m->table.keyvalues_number)-1);
+}
+
+// Replaces an existing number-keyed value of m with a copy of val.
+static matteValue_t * object_array_set_fast(matteStore_t * store, matteObject_t * m, uint32_t index, matteValue_t val) {
+    matteValue_t out = matte_store_new_value(store);
+    matte_value_into_copy(store, &out, val);
+    if (matte_value_type(val) == MATTE_VALUE_TYPE_OBJECT) {    
+        object_link_parent_value(store, m, &val);
+    }
+    matteValue_t * slot = &matte_array_at(m->table.keyvalues_number, matteValue_t, index);
+    if (matte_value_type(*slot) == MATTE_VALUE_TYPE_OBJECT) {
+        object_unlink_parent_value(store, m, slot);
+    }
+    matte_store_recycle(store, *slot);
+    *slot = out;
+    return slot;
+}
+
 static matteValue_t * object_put_prop(matteStore_t * store, matteObject_t * m, matteValue_t key, matteValue_t val) {
+    OBJECT_STORAGE_DETACH(store, m);
     matteValue_t out = matte_store_new_value(store);
     matte_value_into_copy(store, &out, val);
 
@@ -835,13 +1013,15 @@ static const char * BUILTIN_NUMBER__NAMES[] = {
     "PI",
     "parse",
     "random",
+    "seed",
     NULL
 };
 
 static int BUILTIN_NUMBER__IDS[] = {
     MATTE_EXT_CALL__NUMBER__PI,
     MATTE_EXT_CALL__NUMBER__PARSE,
-    MATTE_EXT_CALL__NUMBER__RANDOM
+    MATTE_EXT_CALL__NUMBER__RANDOM,
+    MATTE_EXT_CALL__NUMBER__SEED
 };
 
 static const char * BUILTIN_STRING__NAMES[] = {
@@ -860,6 +1040,7 @@ static const char * BUILTIN_OBJECT__NAMES[] = {
     "freezeGC",
     "thawGC",
     "garbageCollect",
+    "freeze",
     NULL
 };
 
@@ -869,7 +1050,8 @@ static int BUILTIN_OBJECT__IDS[] = {
     MATTE_EXT_CALL__OBJECT__INSTANTIATE,
     MATTE_EXT_CALL__OBJECT__FREEZEGC,
     MATTE_EXT_CALL__OBJECT__THAWGC,
-    MATTE_EXT_CALL__OBJECT__GARBAGECOLLECT
+    MATTE_EXT_CALL__OBJECT__GARBAGECOLLECT,
+    MATTE_EXT_CALL__OBJECT__FREEZE
 };
 
 
@@ -910,15 +1092,13 @@ matteStore_t * matte_store_create(matteVM_t * vm) {
     //out->verifiedRoot = matte_table_create_hash_pointer();
     out->stringStore = matte_string_store_create();
     out->toRemove = matte_array_create(sizeof(uint32_t));
+    out->frozen = matte_array_create(sizeof(uint32_t));
     out->external = matte_array_create(sizeof(matteValue_t));
-    out->kvIter_v = matte_array_create(sizeof(matteValue_t));
-    out->kvIter_k = matte_array_create(sizeof(matteValue_t));
     out->pendingRoots = 0;
 
     MatteTypeData dummyD = {};
     matte_array_push(out->typecode2data, dummyD);
 
-    srand(time(NULL));
     out->type_number_methods = matte_table_create_hash_pointer();
     out->type_object_methods = matte_table_create_hash_pointer();
     out->type_string_methods = matte_table_create_hash_pointer();
@@ -993,6 +1173,10 @@ matteStore_t * matte_store_create(matteVM_t * vm) {
     out->specialString_key.binIDreserved = MATTE_VALUE_TYPE_STRING;
     out->specialString_value.value.id = matte_string_store_ref_cstring(out->stringStore, "value");
     out->specialString_value.binIDreserved = MATTE_VALUE_TYPE_STRING;
+    out->specialString_a.value.id = matte_string_store_ref_cstring(out->stringStore, "a");
+    out->specialString_a.binIDreserved = MATTE_VALUE_TYPE_STRING;
+    out->specialString_b.value.id = matte_string_store_ref_cstring(out->stringStore, "b");
+    out->specialString_b.binIDreserved = MATTE_VALUE_TYPE_STRING;
     
     add_table_refs(out->type_number_methods, out->stringStore, BUILTIN_NUMBER__NAMES, BUILTIN_NUMBER__IDS);
     add_table_refs(out->type_object_methods, out->stringStore, BUILTIN_OBJECT__NAMES, BUILTIN_OBJECT__IDS);
@@ -1020,6 +1204,16 @@ void matte_store_destroy(matteStore_t * h) {
 
     matte_value_object_pop_lock(h, matte_store_empty_function(h));
     matte_array_destroy(h->external);
+
+    // frozen objects rejoin the collector so they are released with the rest.
+    len = matte_array_get_size(h->frozen);
+    for(i = 0; i < len; ++i) {
+        matteObject_t * f = matte_store_bin_fetch(h->bin, matte_array_at(h->frozen, uint32_t, i));
+        DISABLE_STATE(f, OBJECT_STATE__FROZEN);
+        f->color = OBJECT_TRICOLOR__WHITE;
+        matte_store_garbage_collect__add_to_color(h, f);
+    }
+    matte_array_destroy(h->frozen);
     
     while(
         h->tricolor[OBJECT_TRICOLOR__GREY] || 
@@ -1057,8 +1251,6 @@ void matte_store_destroy(matteStore_t * h) {
     matte_table_iter_destroy(h->freeIter);
     matte_pool_destroy(h->nodes);
 
-    matte_array_destroy(h->kvIter_v);
-    matte_array_destroy(h->kvIter_k);
 
     matte_deallocate(h);
 }
@@ -1363,7 +1555,100 @@ void matte_value_into_string_(matteStore_t * store, matteValue_t * v, const matt
     v->binIDreserved = MATTE_VALUE_TYPE_STRING;
     v->value.id = matte_string_store_ref(store->stringStore, str);
 }
+
+void matte_value_into_string_shared_(matteStore_t * store, matteValue_t * v, const matteString_t * str) {
+    matte_store_recycle(store, *v);
+    v->binIDreserved = MATTE_VALUE_TYPE_STRING;
+    v->value.id = matte_string_store_ref_shared(store->stringStore, str);
+}
+
+// Applies a math query to each element of an array of numbers, giving 
+// a new array. Numbers are read and written in their stored form, so 
+// each kernel is a plain loop over 64-bit words that can be vectorized.
+static matteValue_t object_math_query(matteStore_t * store, matteValue_t v, matteQuery_t query) {
+    matteValue_t out = matte_store_new_value(store);
+    if (!matte_value_object_is_plain_array(store, v)) {
+        matte_vm_raise_error_cstring(store->vm, "Math queries on an Object require an array of Numbers.");
+        return out;
+    }
+    matteObject_t * m = matte_store_bin_fetch_table(store->bin, v.value.id);
+    uint32_t len = m->table.keyvalues_number ? matte_array_get_size(m->table.keyvalues_number) : 0;
+    const uint64_t * restrict src = len ? (const uint64_t*)matte_array_get_data(m->table.keyvalues_number) : NULL;
+    uint32_t i;
+
+    // numbers are the only values with the lowest bit set.
+    uint64_t numbers = 1;
+    for(i = 0; i < len; ++i)
+        numbers &= src[i];
+    if (!numbers) {
+        for(i = 0; i < len; ++i) {
+            if (!(src[i] & 1)) break;
+        }
+        matteString_t * err = matte_string_create_from_c_str("Math query failed: element %d is not a Number.", (int)i);
+        matte_vm_raise_error_string(store->vm, err);
+        matte_string_destroy(err);
+        return out;
+    }
+
+    matte_value_into_new_object_ref(store, &out);
+    matteObject_t * d = matte_store_bin_fetch_table(store->bin, out.value.id);
+    if (!d->table.keyvalues_number) d->table.keyvalues_number = matte_array_create(sizeof(matteValue_t));
+    matte_array_set_size(d->table.keyvalues_number, len);
+    if (!len) return out;
+    uint64_t * restrict dst = (uint64_t*)matte_array_get_data(d->table.keyvalues_number);
+
+    #define OBJECT_MATH_KERNEL(__EXPR__) \
+        for(i = 0; i < len; ++i) { \
+            uint64_t bits = src[i] & ~(uint64_t)1; \
+            double x; \
+            memcpy(&x, &bits, sizeof(double)); \
+            x = (__EXPR__); \
+            memcpy(&bits, &x, sizeof(double)); \
+            dst[i] = bits | 1; \
+        }
+
+    switch(query) {
+      case MATTE_QUERY__COS:     OBJECT_MATH_KERNEL(cos(x));   break;
+      case MATTE_QUERY__SIN:     OBJECT_MATH_KERNEL(sin(x));   break;
+      case MATTE_QUERY__TAN:     OBJECT_MATH_KERNEL(tan(x));   break;
+      case MATTE_QUERY__ACOS:    OBJECT_MATH_KERNEL(acos(x));  break;
+      case MATTE_QUERY__ASIN:    OBJECT_MATH_KERNEL(asin(x));  break;
+      case MATTE_QUERY__ATAN:    OBJECT_MATH_KERNEL(atan(x));  break;
+      case MATTE_QUERY__SQRT:    OBJECT_MATH_KERNEL(sqrt(x));  break;
+      case MATTE_QUERY__ABS:     OBJECT_MATH_KERNEL(fabs(x));  break;
+      case MATTE_QUERY__FLOOR:   OBJECT_MATH_KERNEL(floor(x)); break;
+      case MATTE_QUERY__CEIL:    OBJECT_MATH_KERNEL(ceil(x));  break;
+      case MATTE_QUERY__ROUND:   OBJECT_MATH_KERNEL(round(x)); break;
+      case MATTE_QUERY__RADIANS: OBJECT_MATH_KERNEL(x * (MATTE_PI / 180.0)); break;
+      case MATTE_QUERY__DEGREES: OBJECT_MATH_KERNEL(x * (180.0 / MATTE_PI)); break;
+      default:;
+    }
+    #undef OBJECT_MATH_KERNEL
+    return out;
+}
+
 matteValue_t matte_value_query(matteStore_t * store, matteValue_t * v, matteQuery_t query) {
+    // math queries on arrays apply to every element.
+    if (matte_value_type(*v) == MATTE_VALUE_TYPE_OBJECT) {
+        switch(query) {
+          case MATTE_QUERY__COS:
+          case MATTE_QUERY__SIN:
+          case MATTE_QUERY__TAN:
+          case MATTE_QUERY__ACOS:
+          case MATTE_QUERY__ASIN:
+          case MATTE_QUERY__ATAN:
+          case MATTE_QUERY__SQRT:
+          case MATTE_QUERY__ABS:
+          case MATTE_QUERY__FLOOR:
+          case MATTE_QUERY__CEIL:
+          case MATTE_QUERY__ROUND:
+          case MATTE_QUERY__RADIANS:
+          case MATTE_QUERY__DEGREES:
+            return object_math_query(store, *v, query);
+          default:;
+        }
+    }
+
     matteValue_t out = matte_store_new_value(store);
     switch(query) {
       case MATTE_QUERY__TYPE:
@@ -2059,6 +2344,11 @@ matteValue_t matte_value_frame_get_named_referrable(matteStore_t * store, matteV
             printf("Looking in args..\n");
         #endif
         matteObject_t * origin = matte_store_bin_fetch_function(store->bin, originID);
+        // referrables held by a finished call that owned them itself.
+        if (!origin->function.vars->referrables) {
+            originID = origin->function.origin;
+            continue;
+        }
 
 
         len = matte_bytecode_stub_arg_count(origin->function.stub);
@@ -2160,6 +2450,21 @@ const matteValue_t ** matte_value_object_function_activate_closure(
     return (const matteValue_t **)m->function.vars->captures;
 }
 
+const matteValue_t ** matte_value_object_function_activate_closure_detached(
+    matteStore_t * store, 
+    matteValue_t v, 
+    matteValue_t * refs
+) {
+    matteObject_t * m = matte_store_bin_fetch_function(store->bin, v.value.id);
+    // visible for lookups by name, but not owned or linked.
+    m->function.vars->referrables = refs;
+    return (const matteValue_t **)m->function.vars->captures;
+}
+
+void matte_value_object_function_deactivate_closure(matteStore_t * store, matteValue_t v) {
+    matteObject_t * m = matte_store_bin_fetch_function(store->bin, v.value.id);
+    m->function.vars->referrables = NULL;
+}
 
 void matte_value_into_cloned_function_ref_(matteStore_t * store, matteValue_t * v, matteValue_t source) {
     matte_store_recycle(store, *v);
@@ -2320,8 +2625,151 @@ matteValue_t * matte_value_object_array_at_unsafe(matteStore_t * store, matteVal
     return &matte_array_at(d->table.keyvalues_number, matteValue_t, index);
 }
 
+int matte_value_object_is_plain_array(matteStore_t * store, matteValue_t v) {
+    if (matte_value_type(v) != MATTE_VALUE_TYPE_OBJECT || IS_FUNCTION_ID(v.value.id)) return 0;
+    matteObject_t * m = matte_store_bin_fetch_table(store->bin, v.value.id);
+    if (QUERY_STATE(m, OBJECT_STATE__HAS_INTERFACE) ||
+        QUERY_STATE(m, OBJECT_STATE__HAS_LAYOUT)) return 0;
+    if (m->table.attribSet && matte_value_type(*m->table.attribSet)) return 0;
+    if (m->table.keyvalues_id && matte_mvt2_get_size(m->table.keyvalues_id)) return 0;
+    return 1;
+}
+
+int matte_value_object_share_into(matteStore_t * store, matteValue_t target, matteValue_t src) {
+    if (matte_value_type(src) != MATTE_VALUE_TYPE_OBJECT || IS_FUNCTION_ID(src.value.id)) return 0;
+    if (matte_value_type(target) != MATTE_VALUE_TYPE_OBJECT || IS_FUNCTION_ID(target.value.id)) return 0;
+    matteObject_t * m = matte_store_bin_fetch_table(store->bin, src.value.id);
+    matteObject_t * t = matte_store_bin_fetch_table(store->bin, target.value.id);
+    if (QUERY_STATE(m, OBJECT_STATE__HAS_INTERFACE | OBJECT_STATE__HAS_LAYOUT | OBJECT_STATE__FROZEN) ||
+        QUERY_STATE(t, OBJECT_STATE__HAS_INTERFACE | OBJECT_STATE__HAS_LAYOUT | OBJECT_STATE__SHARED_STORAGE)) return 0;
+    if (m->table.attribSet || m->table.privateBinding ||
+        t->table.attribSet || t->table.privateBinding || t->children) return 0;
+    if ((t->table.keyvalues_id && matte_mvt2_get_size(t->table.keyvalues_id)) ||
+        (t->table.keyvalues_number && matte_array_get_size(t->table.keyvalues_number))) return 0;
+
+    // small objects are cheaper to copy outright.
+    uint32_t count = 
+        (m->table.keyvalues_id ? matte_mvt2_get_size(m->table.keyvalues_id) : 0) +
+        (m->table.keyvalues_number ? matte_array_get_size(m->table.keyvalues_number) : 0);
+    if (count < OBJECT_SHARE_MIN_KEYS) return 0;
+    
+    matteObject_t * storage = QUERY_STATE(m, OBJECT_STATE__SHARED_STORAGE) ?
+        object_storage_find(store, m)
+    :
+        object_storage_create(store, m);
+    if (!storage) return 0;
+    
+    if (t->table.keyvalues_id) matte_mvt2_destroy(t->table.keyvalues_id);
+    if (t->table.keyvalues_number) matte_array_destroy(t->table.keyvalues_number);
+    object_storage_link(store, t, storage);
+    return 1;
+}
+
+int matte_value_object_spread_into(matteStore_t * store, matteValue_t target, matteValue_t src) {
+    if (matte_value_type(src) != MATTE_VALUE_TYPE_OBJECT || IS_FUNCTION_ID(src.value.id)) return 0;
+    if (matte_value_type(target) != MATTE_VALUE_TYPE_OBJECT || IS_FUNCTION_ID(target.value.id)) return 0;
+    matteObject_t * m = matte_store_bin_fetch_table(store->bin, src.value.id);
+    if (QUERY_STATE(m, OBJECT_STATE__HAS_INTERFACE) ||
+        QUERY_STATE(m, OBJECT_STATE__HAS_LAYOUT)) return 0;
+    if (m->table.attribSet && matte_value_type(*m->table.attribSet)) return 0;
+    matteObject_t * t = matte_store_bin_fetch_table(store->bin, target.value.id);
+    if (QUERY_STATE(t, OBJECT_STATE__HAS_INTERFACE) ||
+        QUERY_STATE(t, OBJECT_STATE__HAS_LAYOUT)) return 0;
+    if (t->table.attribSet && matte_value_type(*t->table.attribSet)) return 0;
+
+    if (matte_value_object_share_into(store, target, src)) return 1;
+
+    if (m->table.keyvalues_id) {
+        matteMVT2Iter_t iter;
+        matteValue_t key;
+        matteValue_t * value;
+        matte_mvt2_iter_start(&iter, m->table.keyvalues_id);
+        while(matte_mvt2_iter_next(&iter, &key, &value)) {
+            matte_value_object_set(store, target, key, *value, 1);
+        }
+        #ifdef MATTE_DEBUG
+            assert(matte_mvt2_iter_is_valid(&iter));
+        #endif
+    }
+    
+    uint32_t i;
+    uint32_t len = m->table.keyvalues_number ? matte_array_get_size(m->table.keyvalues_number) : 0;
+    for(i = 0; i < len; ++i) {
+        matteValue_t key = matte_store_new_value(store);
+        matte_value_into_number(store, &key, i);
+        m = matte_store_bin_fetch_table(store->bin, src.value.id);
+        matte_value_object_set(store, target, key, matte_array_at(m->table.keyvalues_number, matteValue_t, i), 1);
+    }
+    return 1;
+}
+
+void matte_value_object_freeze(matteStore_t * store, matteValue_t v) {
+    if (matte_value_type(v) != MATTE_VALUE_TYPE_OBJECT) {
+        matte_vm_raise_error_cstring(store->vm, "Only Objects can be frozen.");
+        return;
+    }
+    matteObject_t * m = matte_store_bin_fetch(store->bin, v.value.id);
+    if (QUERY_STATE(m, OBJECT_STATE__FROZEN)) return;
+
+    // The reachable graph is gathered first so that nothing 
+    // is frozen if any part of it cannot be.
+    matteArray_t * graph = matte_array_create(sizeof(uint32_t));
+    matteTable_t * seen = matte_table_create_hash_pointer();
+    matte_array_push(graph, m->storeID);
+    matte_table_insert_by_uint(seen, m->storeID, (void*)0x1);
+
+    uint32_t i;
+    for(i = 0; i < matte_array_get_size(graph); ++i) {
+        m = matte_store_bin_fetch(store->bin, matte_array_at(graph, uint32_t, i));
+        if (IS_FUNCTION_OBJECT(m)) {
+            matte_vm_raise_error_cstring(store->vm, "Cannot freeze an Object that refers to a Function.");
+            matte_table_destroy(seen);
+            matte_array_destroy(graph);
+            return;
+        }
+        OBJECT_STORAGE_DETACH(store, m);
+
+        matteObjectNode_t * next = m->children ? matte_pool_fetch(store->nodes, matteObjectNode_t, m->children) : NULL;
+        while(next) {
+            matteObject_t * child = next->data;
+            next = next->next;
+            if (QUERY_STATE(child, OBJECT_STATE__FROZEN) ||
+                matte_table_find_by_uint(seen, child->storeID)) continue;
+            matte_table_insert_by_uint(seen, child->storeID, (void*)0x1);
+            matte_array_push(graph, child->storeID);
+        }
+    }
+
+    // Frozen objects leave the tricolor lists for good. Their edges 
+    // only ever lead to other frozen objects, so they are dropped.
+    for(i = 0; i < matte_array_get_size(graph); ++i) {
+        m = matte_store_bin_fetch(store->bin, matte_array_at(graph, uint32_t, i));
+        matte_store_garbage_collect__rem_from_color(store, m);
+        m->color = OBJECT_TRICOLOR__BLACK;
+        ENABLE_STATE(m, OBJECT_STATE__FROZEN);
+
+        matteObjectNode_t * next = m->children ? matte_pool_fetch(store->nodes, matteObjectNode_t, m->children) : NULL;
+        while(next) {
+            matteObjectNode_t * old = next;
+            next = next->next;
+            matte_pool_recycle(store->nodes, old->self);
+        }
+        m->children = 0;
+        matte_array_push(store->frozen, m->storeID);
+    }
+    matte_table_destroy(seen);
+    matte_array_destroy(graph);
+}
+
+int matte_value_object_is_frozen(matteStore_t * store, matteValue_t v) {
+    if (matte_value_type(v) != MATTE_VALUE_TYPE_OBJECT) return 0;
+    return QUERY_STATE(matte_store_bin_fetch(store->bin, v.value.id), OBJECT_STATE__FROZEN);
+}
+
 void matte_value_object_array_set_size_unsafe(matteStore_t * store, matteValue_t v, uint32_t size) {
     matteObject_t * d = matte_store_bin_fetch_table(store->bin, v.value.id);
+    if (object_frozen_error(store, d)) return;
+    OBJECT_STORAGE_DETACH(store, d);
     if (!d->table.keyvalues_number) d->table.keyvalues_number = matte_array_create(sizeof(matteValue_t));//(matteArray_t*)matte_pool_fetch(store->keyvalues_numberPool);
     matteArray_t * arr = d->table.keyvalues_number;
     uint32_t i;
@@ -2679,19 +3127,12 @@ matteValue_t matte_value_as_string(matteStore_t * store, matteValue_t v) {
         return out;
       }
 
-      // slow.. make fast please!
       case MATTE_VALUE_TYPE_NUMBER: {        
-        matteString_t * str;
-        double val = matte_value_get_number(v);
-        if (fabs(val - (int64_t)val) < DBL_EPSILON) {
-            str = matte_string_create_from_c_str("%" PRId64 "", (int64_t)val);                
-        } else {
-            str = matte_string_create_from_c_str("%.15g", val);        
-        }
+        char str[MATTE_NUMBER_C_STR_MAX];
+        matte_number_value_to_c_str(matte_value_get_number(v), str);
         matteValue_t out;
         out.binIDreserved = MATTE_VALUE_TYPE_STRING;
-        out.value.id = matte_string_store_ref(store->stringStore, str);
-        matte_string_destroy(str);        
+        out.value.id = matte_string_store_ref_cstring(store->stringStore, str);
         return out;        
       }
       case MATTE_VALUE_TYPE_BOOLEAN: {
@@ -3162,7 +3603,7 @@ void matte_value_object_pop_lock_(matteStore_t * store, matteValue_t v) {
     if (m->rootState) {
         m->rootState--;
         if (m->rootState == 0) {
-            if (m->color == OBJECT_TRICOLOR__BLACK) {
+            if (m->color == OBJECT_TRICOLOR__BLACK && !QUERY_STATE(m, OBJECT_STATE__FROZEN)) {
                 matte_store_garbage_collect__rem_from_color(store, m);
                 m->color = OBJECT_TRICOLOR__GREY;
                 matte_store_garbage_collect__add_to_color(store, m);
@@ -3177,6 +3618,18 @@ void matte_value_object_pop_lock_(matteStore_t * store, matteValue_t v) {
 
 
 
+// Appends a copy of a value to the number keys of an object being built.
+static void object_array_append(matteStore_t * store, matteValue_t v, matteValue_t val) {
+    matteObject_t * d = matte_store_bin_fetch_table(store->bin, v.value.id);
+    if (!d->table.keyvalues_number) d->table.keyvalues_number = matte_array_create(sizeof(matteValue_t));
+    matteValue_t copy = matte_store_new_value(store);
+    matte_value_into_copy(store, &copy, val);
+    matte_array_push(d->table.keyvalues_number, copy);
+    if (matte_value_type(copy) == MATTE_VALUE_TYPE_OBJECT) {
+        object_link_parent_value(store, d, &copy);
+    }
+}
+
 matteValue_t matte_value_object_keys(matteStore_t * store, matteValue_t v) {
     if (matte_value_type(v) != MATTE_VALUE_TYPE_OBJECT || IS_FUNCTION_ID(v.value.id)) {
         matte_vm_raise_error_string(store->vm, MATTE_VM_STR_CAST(store->vm, "Can only get keys from something that's an Object."));        
@@ -3192,59 +3645,47 @@ matteValue_t matte_value_object_keys(matteStore_t * store, matteValue_t v) {
             return matte_value_object_values(store, v);
         }    
     }
-    matteArray_t * keys = matte_array_create(sizeof(matteValue_t));
-    matteValue_t val;
+    int numbered = 
+        !QUERY_STATE(m, OBJECT_STATE__HAS_INTERFACE) &&
+        !QUERY_STATE(m, OBJECT_STATE__HAS_LAYOUT);
+    uint32_t len = 
+        (m->table.keyvalues_id ? matte_mvt2_get_size(m->table.keyvalues_id) : 0) +
+        (numbered && m->table.keyvalues_number ? matte_array_get_size(m->table.keyvalues_number) : 0);
+
+    // keys are written straight into the new array rather than gathered first.
+    matteValue_t val = matte_store_new_value(store);
+    matte_value_into_new_object_ref(store, &val);
+    matte_value_object_push_lock(store, val);
+    matte_value_object_reserve(store, val, len);
+    m = matte_store_bin_fetch_table(store->bin, v.value.id);
 
 
     // then string
-    matteArray_t * keyed = store->kvIter_k;
-    keyed->size = 0;
     if (m->table.keyvalues_id) {
-        matte_mvt2_get_all_keys(m->table.keyvalues_id, keyed);
-        uint32_t len = matte_array_get_size(keyed);
-        uint32_t i;
-        matteValue_t * iter = (matteValue_t*)matte_array_get_data(keyed);
-        for(i = 0; i < len; ++i, iter++) {
-            matteValue_t key = (*iter);
-            if (matte_value_type(key) == MATTE_VALUE_TYPE_STRING)
-                matte_string_store_ref_id(store->stringStore, key.value.id);
-
+        matteMVT2Iter_t iter;
+        matteValue_t key;
+        matteValue_t * value;
+        matte_mvt2_iter_start(&iter, m->table.keyvalues_id);
+        while(matte_mvt2_iter_next(&iter, &key, &value)) {
             #ifdef MATTE_DEBUG__STORE
                 if (matte_value_type(key) == MATTE_VALUE_TYPE_OBJECT)
                     matte_store_track_in(store, key, "object.keys()", 0);
             #endif
-
-
-            matte_array_push(keys, key);                
+            object_array_append(store, val, key);
         }
     }
-    uint32_t i;
-    uint32_t len;
-    if (!QUERY_STATE(m, OBJECT_STATE__HAS_INTERFACE) &&
-        !QUERY_STATE(m, OBJECT_STATE__HAS_LAYOUT)) {
-    
-
+    if (numbered) {
         // first number 
+        uint32_t i;
         len = m->table.keyvalues_number ? matte_array_get_size(m->table.keyvalues_number) : 0;
-        if (len) {
-            for(i = 0; i < len; ++i) {
-                matteValue_t key = matte_store_new_value(store);
-                matte_value_into_number(store, &key, i);
-                matte_array_push(keys, key);
-            }
+        for(i = 0; i < len; ++i) {
+            matteValue_t key = matte_store_new_value(store);
+            matte_value_into_number(store, &key, i);
+            object_array_append(store, val, key);
         }
-
     }
     
-
-    
-    val = matte_store_new_value(store);
-    matte_value_into_new_object_array_ref(store, &val, keys);
-    len = matte_array_get_size(keys);
-    for(i = 0; i < len; ++i) {
-        matte_store_recycle(store, matte_array_at(keys, matteValue_t, i));
-    }
-    matte_array_destroy(keys);
+    matte_value_object_pop_lock(store, val);
     return val;
 }
 
@@ -3271,89 +3712,81 @@ matteValue_t matte_value_object_values(matteStore_t * store, matteValue_t v) {
     }
 
 
-    matteArray_t * vals = matte_array_create(sizeof(matteValue_t));
-    matteValue_t val;
-    // first number 
+    // values are written straight into the new array rather than gathered first.
+    matteValue_t val = matte_store_new_value(store);
+    matte_value_into_new_object_ref(store, &val);
+    matte_value_object_push_lock(store, val);
+    m = matte_store_bin_fetch_table(store->bin, v.value.id);
+    matte_value_object_reserve(store, val, 
+        (m->table.keyvalues_id ? matte_mvt2_get_size(m->table.keyvalues_id) : 0) +
+        (m->table.keyvalues_number ? matte_array_get_size(m->table.keyvalues_number) : 0)
+    );
+    m = matte_store_bin_fetch_table(store->bin, v.value.id);
 
-    matteArray_t * keyed = store->kvIter_v;
-    keyed->size = 0;
     // then string
     if (m->table.keyvalues_id) {
-        matte_mvt2_get_all_values(m->table.keyvalues_id, keyed);
-        if (keyed->size) {
-            uint32_t len = matte_array_get_size(keyed);
-            uint32_t i;
-            matteValue_t * iter = (matteValue_t*)matte_array_get_data(keyed);
+        matteMVT2Iter_t iter;
+        matteValue_t key;
+        matteValue_t * value;
+        matte_mvt2_iter_start(&iter, m->table.keyvalues_id);
 
-            if (QUERY_STATE(m, OBJECT_STATE__HAS_INTERFACE)) {
-                for(i = 0; i < len; ++i, iter++) {
-                    matteValue_t * val = iter;
-
-                    if (IS_FUNCTION_ID(val->value.id)) {
-                        matteValue_t vv = matte_store_new_value(store);
-                        matte_value_into_copy(store, &vv, *val);                    
-                        matte_array_push(vals, vv);
-                        continue;                
-                    }
-                    matteObject_t * setget = matte_store_bin_fetch_table(store->bin, val->value.id);
+        if (QUERY_STATE(m, OBJECT_STATE__HAS_INTERFACE)) {
+            // getters can run anything, so the accessors are gathered first.
+            matteArray_t * setgets = matte_array_create(sizeof(matteValue_t));
+            while(matte_mvt2_iter_next(&iter, &key, &value)) {
+                matte_array_push(setgets, *value);
+            }
+            
+            uint32_t i;
+            uint32_t len = matte_array_get_size(setgets);
+            for(i = 0; i < len; ++i) {
+                matteValue_t * setgetv = &matte_array_at(setgets, matteValue_t, i);
 
-                    if (setget->table.keyvalues_id == NULL) {
-                        continue;
-                    }
-                    matteValue_t * getter = matte_mvt2_find(setget->table.keyvalues_id, store->specialString_get);
-                    if (getter == NULL) {
-                        continue;
-                    }
+                if (IS_FUNCTION_ID(setgetv->value.id)) {
+                    object_array_append(store, val, *setgetv);
+                    continue;                
+                }
+                matteObject_t * setget = matte_store_bin_fetch_table(store->bin, setgetv->value.id);
 
-                    matteValue_t vv = matte_vm_call_full(
-                        store->vm, 
-                        *getter, 
-                        matte_value_object_get_interface_private_binding_unsafe(store, v),
-                        matte_array_empty(), 
-                        matte_array_empty(), 
-                        NULL
-                    );
+                if (setget->table.keyvalues_id == NULL) {
+                    continue;
+                }
+                matteValue_t * getter = matte_mvt2_find(setget->table.keyvalues_id, store->specialString_get);
+                if (getter == NULL) {
+                    continue;
+                }
 
-                    m = matte_store_bin_fetch_table(store->bin, v.value.id);
-                    matte_array_push(vals, vv);                
-                }    
-            } else {
-                for(i = 0; i < len; ++i, iter++) {
-                    val = matte_store_new_value(store);
-                    matte_value_into_copy(store, &val, *iter);
-                    matte_array_push(vals, val);                
-                }    
-            
+                matteValue_t vv = matte_vm_call_full(
+                    store->vm, 
+                    *getter, 
+                    matte_value_object_get_interface_private_binding_unsafe(store, v),
+                    matte_array_empty(), 
+                    matte_array_empty(), 
+                    NULL
+                );
+                object_array_append(store, val, vv);
+                matte_store_recycle(store, vv);
             }
-            keyed->size = 0;
-        }        
+            matte_array_destroy(setgets);
+        } else {
+            while(matte_mvt2_iter_next(&iter, &key, &value)) {
+                object_array_append(store, val, *value);
+            }
+        }
     }    
     
     
-    uint32_t i;
-    uint32_t len;
-
+    m = matte_store_bin_fetch_table(store->bin, v.value.id);
     if (!QUERY_STATE(m, OBJECT_STATE__HAS_INTERFACE) &&
         !QUERY_STATE(m, OBJECT_STATE__HAS_LAYOUT)) {
-        len = m->table.keyvalues_number ? matte_array_get_size(m->table.keyvalues_number) : 0;
-
-        if (len) {
-            for(i = 0; i < len; ++i) {
-                val = matte_store_new_value(store);
-                matte_value_into_copy(store, &val, matte_array_at(m->table.keyvalues_number, matteValue_t, i));
-                matte_array_push(vals, val);
-            }
+        uint32_t i;
+        uint32_t len = m->table.keyvalues_number ? matte_array_get_size(m->table.keyvalues_number) : 0;
+        for(i = 0; i < len; ++i) {
+            object_array_append(store, val, matte_array_at(m->table.keyvalues_number, matteValue_t, i));
         }
     }        
 
-
-    val = matte_store_new_value(store);
-    matte_value_into_new_object_array_ref(store, &val, vals);
-    len = matte_array_get_size(vals);
-    for(i = 0; i < len; ++i) {
-        matte_store_recycle(store, matte_array_at(vals, matteValue_t, i));
-    }
-    matte_array_destroy(vals);
+    matte_value_object_pop_lock(store, val);
     return val;
 }
 
@@ -3394,6 +3827,8 @@ void matte_value_object_remove_key(matteStore_t * store, matteValue_t v, matteVa
         return;
     }
     matteObject_t * m = matte_store_bin_fetch_table(store->bin, v.value.id);
+    if (object_frozen_error(store, m)) return;
+    OBJECT_STORAGE_DETACH(store, m);
     switch(matte_value_type(key)) {
       case MATTE_VALUE_TYPE_EMPTY: return;
 
@@ -3497,27 +3932,33 @@ void matte_value_object_foreach(matteStore_t * store, matteValue_t v, matteValue
 
     matteArray_t argNames_array = MATTE_ARRAY_CAST(argNames, matteValue_t, 2);
 
+    // keys and values are snapshot once, as the function may change the object.
+    uint32_t i;
+    uint32_t len = 
+        (m->table.keyvalues_id ? matte_mvt2_get_size(m->table.keyvalues_id) : 0) +
+        (m->table.keyvalues_number ? matte_array_get_size(m->table.keyvalues_number) : 0);
     matteArray_t *keys   = matte_array_create(sizeof(matteValue_t));
     matteArray_t *values = matte_array_create(sizeof(matteValue_t));
-
-    // first number 
-    uint32_t i;
-    uint32_t len;
-
-    matteArray_t * keyIter = matte_array_create(sizeof(matteValue_t));
-    matteArray_t * valIter = matte_array_create(sizeof(matteValue_t));
-    
-    keyIter->size = 0;
-    valIter->size = 0;
+    matte_array_set_size(keys, len);
+    matte_array_set_size(values, len);
+    keys->size = 0;
+    values->size = 0;
 
     // then string
     if (m->table.keyvalues_id && matte_mvt2_get_size(m->table.keyvalues_id)) {
-        matte_mvt2_get_all_keys(m->table.keyvalues_id, keyIter);
-        matte_mvt2_get_all_values(m->table.keyvalues_id, valIter);
-        len = matte_array_get_size(keyIter);
-
+        matteMVT2Iter_t iter;
+        matteValue_t * value;
+        matte_mvt2_iter_start(&iter, m->table.keyvalues_id);
 
         if (QUERY_STATE(m, OBJECT_STATE__HAS_INTERFACE)) {
+            // getters can run anything, so the accessors are gathered first.
+            matteArray_t * keyIter = matte_array_create(sizeof(matteValue_t));
+            matteArray_t * valIter = matte_array_create(sizeof(matteValue_t));
+            while(matte_mvt2_iter_next(&iter, &args[0], &value)) {
+                matte_array_push(keyIter, args[0]);
+                matte_array_push(valIter, *value);
+            }
+            len = matte_array_get_size(keyIter);
             for(i = 0; i < len; ++i) {
                 args[1] = matte_array_at(valIter, matteValue_t, i);
                 args[0] = matte_array_at(keyIter, matteValue_t, i);
@@ -3549,12 +3990,12 @@ void matte_value_object_foreach(matteStore_t * store, matteValue_t v, matteValue
                 matte_array_push(keys, args[0]);
                 matte_array_push(values, args[1]);
             }
+            matte_array_destroy(keyIter);
+            matte_array_destroy(valIter);
         
         } else {
-            for(i = 0; i < len; ++i) {
-                args[1] = matte_array_at(valIter, matteValue_t, i);
-                args[0] = matte_array_at(keyIter, matteValue_t, i);
-
+            while(matte_mvt2_iter_next(&iter, &args[0], &value)) {
+                args[1] = *value;
                 matte_value_object_push_lock(store, args[0]);                
                 matte_value_object_push_lock(store, args[1]);
                 
@@ -3598,8 +4039,6 @@ void matte_value_object_foreach(matteStore_t * store, matteValue_t v, matteValue
     
     matte_array_destroy(keys);
     matte_array_destroy(values);
-    matte_array_destroy(keyIter);
-    matte_array_destroy(valIter);
     
     matte_value_object_pop_lock(store, v);
 
@@ -3671,6 +4110,7 @@ void matte_value_object_set_attributes(matteStore_t * store, matteValue_t v, mat
     }
     
     matteObject_t * m = matte_store_bin_fetch_table(store->bin, v.value.id);
+    if (object_frozen_error(store, m)) return;
     if (m->table.attribSet && matte_value_type(*m->table.attribSet)) {
         object_unlink_parent_value(store, m, m->table.attribSet);
         matte_store_recycle(store, *m->table.attribSet);
@@ -3709,6 +4149,7 @@ void matte_value_object_set_is_interface(
         return;
     }
     matteObject_t * m = matte_store_bin_fetch_table(store->bin, v.value.id);
+    if (object_frozen_error(store, m)) return;
     if (enable)
         ENABLE_STATE(m, OBJECT_STATE__HAS_INTERFACE);    
     else
@@ -3746,29 +4187,166 @@ const matteValue_t * matte_value_object_get_attributes_unsafe(matteStore_t * sto
 
 
 typedef struct {
+    matteValue_t value;
+    // the value compared when sorting natively
+    union {
+        double number;
+        const matteString_t * string;
+    } key;
+} matteValue_Sort_t;  
+
+typedef int (*matteSortCompare_t)(void * data, const matteValue_Sort_t * a, const matteValue_Sort_t * b);
+
+typedef struct {
+    matteStore_t * store;
     matteValue_t fn;
     matteArray_t names;
-    matteStore_t * store;
 } matteParams_Sort_t;
 
-typedef struct {
-    matteValue_t value;
-    matteParams_Sort_t * sort;
-} matteValue_Sort_t;  
-
 static int matte_value_object_sort__cmp(
-    const void * asrc,
-    const void * bsrc
+    void * data,
+    const matteValue_Sort_t * a,
+    const matteValue_Sort_t * b
 ) {
-    matteValue_Sort_t * a = (matteValue_Sort_t *)asrc;
-    matteValue_Sort_t * b = (matteValue_Sort_t *)bsrc;
+    matteParams_Sort_t * sort = (matteParams_Sort_t *)data;
+    // once the comparator has failed, the order no longer matters.
+    if (matte_vm_pending_message(sort->store->vm)) return 0;
 
     matteValue_t args[] = {
         a->value,
         b->value
     };
     matteArray_t arr = MATTE_ARRAY_CAST(args, matteValue_t, 2);
-    return matte_value_as_number(a->sort->store, matte_vm_call(a->sort->store->vm, a->sort->fn, &arr, &a->sort->names, NULL));    
+    matteValue_t r = matte_vm_call(sort->store->vm, sort->fn, &arr, &sort->names, NULL);
+    double result = matte_value_as_number(sort->store, r);
+    matte_store_recycle(sort->store, r);
+    return result < 0 ? -1 : result > 0;
+}
+
+static int matte_value_object_sort__cmp_number(void * data, const matteValue_Sort_t * a, const matteValue_Sort_t * b) {
+    return a->key.number < b->key.number ? -1 : a->key.number > b->key.number;
+}
+
+static int matte_value_object_sort__cmp_number_descending(void * data, const matteValue_Sort_t * a, const matteValue_Sort_t * b) {
+    return matte_value_object_sort__cmp_number(data, b, a);
+}
+
+static int matte_value_object_sort__cmp_string(void * data, const matteValue_Sort_t * a, const matteValue_Sort_t * b) {
+    return matte_string_compare(a->key.string, b->key.string);
+}
+
+static int matte_value_object_sort__cmp_string_descending(void * data, const matteValue_Sort_t * a, const matteValue_Sort_t * b) {
+    return matte_string_compare(b->key.string, a->key.string);
+}
+
+
+// runs shorter than this are extended with insertion sort 
+// before merging.
+#define MATTE_SORT_MIN_RUN 32
+
+// Stable merge sort that takes advantage of runs already in order.
+// Runs are found (strictly descending runs are reversed, which keeps 
+// equal items in order), extended to a minimum length, and then merged 
+// pairwise through a single scratch buffer.
+static void matte_value_object_sort__merge_sort(
+    matteValue_Sort_t * items,
+    uint32_t len,
+    matteSortCompare_t cmp,
+    void * data
+) {
+    if (len < 2) return;
+    matteArray_t * runs = matte_array_create(sizeof(uint32_t));
+    uint32_t i = 0;
+    while(i < len) {
+        uint32_t start = i++;
+        if (i < len) {
+            if (cmp(data, items+i, items+start) < 0) {
+                while(i+1 < len && cmp(data, items+i+1, items+i) < 0) i++;
+                i++;
+                uint32_t lo = start, hi = i-1;
+                while(lo < hi) {
+                    matteValue_Sort_t t = items[lo];
+                    items[lo++] = items[hi];
+                    items[hi--] = t;
+                }
+            } else {
+                while(i+1 < len && cmp(data, items+i+1, items+i) >= 0) i++;
+                i++;
+            }
+        }
+
+        // binary insertion to reach the minimum run length
+        uint32_t end = start + MATTE_SORT_MIN_RUN;
+        if (end > len) end = len;
+        for(; i < end; ++i) {
+            matteValue_Sort_t t = items[i];
+            uint32_t lo = start, hi = i;
+            while(lo < hi) {
+                uint32_t mid = lo + (hi - lo) / 2;
+                if (cmp(data, &t, items+mid) < 0)
+                    hi = mid;
+                else 
+                    lo = mid + 1;
+            }
+            memmove(items+lo+1, items+lo, sizeof(matteValue_Sort_t)*(i-lo));
+            items[lo] = t;
+        }
+        matte_array_push(runs, start);
+    }
+    
+    uint32_t runCount = matte_array_get_size(runs);
+    if (runCount > 1) {
+        matteValue_Sort_t * scratch = (matteValue_Sort_t*)matte_allocate(sizeof(matteValue_Sort_t)*len);
+        while(runCount > 1) {
+            uint32_t out = 0;
+            for(i = 0; i < runCount; i += 2) {
+                uint32_t start = matte_array_at(runs, uint32_t, i);
+                if (i+1 < runCount) {
+                    uint32_t mid = matte_array_at(runs, uint32_t, i+1);
+                    uint32_t end = i+2 < runCount ? matte_array_at(runs, uint32_t, i+2) : len;
+                    
+                    // merge only if the runs are out of order across the boundary
+                    if (cmp(data, items+mid, items+mid-1) < 0) {
+                        uint32_t a = 0, b = mid, n = start;
+                        uint32_t aEnd = mid-start;
+                        memcpy(scratch, items+start, sizeof(matteValue_Sort_t)*aEnd);
+                        while(a < aEnd && b < end) {
+                            if (cmp(data, items+b, scratch+a) < 0)
+                                items[n++] = items[b++];
+                            else 
+                                items[n++] = scratch[a++];
+                        }
+                        memcpy(items+n, scratch+a, sizeof(matteValue_Sort_t)*(aEnd-a));
+                    }
+                }
+                matte_array_at(runs, uint32_t, out++) = start;
+            }
+            runCount = out;
+        }
+        matte_deallocate(scratch);
+    }
+    matte_array_destroy(runs);
+}
+
+
+static void matte_value_object_sort__apply(
+    matteStore_t * store,
+    matteValue_t v,
+    matteValue_Sort_t * items,
+    uint32_t len,
+    matteSortCompare_t cmp,
+    void * data
+) {
+    matte_value_object_sort__merge_sort(items, len, cmp, data);
+    // the comparator may have changed the object, so it is fetched again.
+    matteObject_t * m = matte_store_bin_fetch_table(store->bin, v.value.id);
+    if (!m->table.keyvalues_number || matte_array_get_size(m->table.keyvalues_number) != len ||
+        QUERY_STATE(m, OBJECT_STATE__FROZEN)) return;
+    OBJECT_STORAGE_DETACH(store, m);
+    uint32_t i;
+    for(i = 0; i < len; ++i) {
+        matte_array_at(m->table.keyvalues_number, matteValue_t, i) = items[i].value;
+    }
 }
 
 
@@ -3776,6 +4354,7 @@ void matte_value_object_sort_unsafe(matteStore_t * store, matteValue_t v, matteV
 
 
     matteObject_t * m = matte_store_bin_fetch_table(store->bin, v.value.id);
+    if (object_frozen_error(store, m)) return;
 
     uint32_t len = m->table.keyvalues_number ? matte_array_get_size(m->table.keyvalues_number) : 0;
     if (len < 1) return;
@@ -3787,31 +4366,96 @@ void matte_value_object_sort_unsafe(matteStore_t * store, matteValue_t v, matteV
     matte_value_object_push_lock(store, v);
     matte_value_object_push_lock(store, less);
 
-    matteValue_t names[2];
-    names[0].binIDreserved = MATTE_VALUE_TYPE_STRING;
-    names[1].binIDreserved = MATTE_VALUE_TYPE_STRING;
-    names[0].value.id = matte_string_store_ref_cstring(store->stringStore, "a");
-    names[1].value.id = matte_string_store_ref_cstring(store->stringStore, "b");
+    matteValue_t names[2] = {
+        store->specialString_a,
+        store->specialString_b
+    };
     params.names = MATTE_ARRAY_CAST(names, matteValue_t, 2);
     
     matteValue_Sort_t * sortArray = (matteValue_Sort_t*)matte_allocate(sizeof(matteValue_Sort_t)*len);
     uint32_t i;
     for(i = 0; i < len; ++i) {
         sortArray[i].value = matte_array_at(m->table.keyvalues_number, matteValue_t, i);
-        sortArray[i].sort = &params;
     }
     
-    qsort(sortArray, len, sizeof(matteValue_Sort_t), matte_value_object_sort__cmp);
-    
-    for(i = 0; i < len; ++i) {
-        matte_array_at(m->table.keyvalues_number, matteValue_t, i) = sortArray[i].value;
-    }
+    matte_value_object_sort__apply(store, v, sortArray, len, matte_value_object_sort__cmp, &params);
     matte_deallocate(sortArray);
     
     matte_value_object_pop_lock(store, v);
     matte_value_object_pop_lock(store, less);
+}
 
-   
+void matte_value_object_sort_native_unsafe(matteStore_t * store, matteValue_t v, matteValue_t by, int descending) {
+    matteObject_t * m = matte_store_bin_fetch_table(store->bin, v.value.id);
+    if (object_frozen_error(store, m)) return;
+
+    uint32_t len = m->table.keyvalues_number ? matte_array_get_size(m->table.keyvalues_number) : 0;
+    if (len < 1) return;
+
+    matte_value_object_push_lock(store, v);
+
+    matteValue_Sort_t * sortArray = (matteValue_Sort_t*)matte_allocate(sizeof(matteValue_Sort_t)*len);
+    // keys are held until the sort is done, as string keys 
+    // are compared by reference.
+    matteValue_t * keys = (matteValue_t*)matte_allocate(sizeof(matteValue_t)*len);
+    int keyType = 0;
+    int ok = 1;
+    uint32_t i;
+    for(i = 0; i < len && ok; ++i) {
+        // key access can run attributes, which may change the object.
+        m = matte_store_bin_fetch_table(store->bin, v.value.id);
+        if (!m->table.keyvalues_number || i >= matte_array_get_size(m->table.keyvalues_number)) {
+            keys[i] = matte_store_new_value(store);
+            ok = 0;
+            continue;
+        }
+        sortArray[i].value = matte_array_at(m->table.keyvalues_number, matteValue_t, i);
+        if (matte_value_type(by)) {
+            if (matte_value_type(sortArray[i].value) != MATTE_VALUE_TYPE_OBJECT || IS_FUNCTION_ID(sortArray[i].value.value.id)) {
+                matte_vm_raise_error_cstring(store->vm, "Sorting by a key requires all values to be objects.");
+                keys[i] = matte_store_new_value(store);
+                ok = 0;
+                continue;
+            }
+            keys[i] = matte_value_object_access(store, sortArray[i].value, by, 1);
+            if (matte_vm_pending_message(store->vm)) {
+                ok = 0;
+                continue;
+            }
+        } else {
+            keys[i] = matte_store_new_value(store);
+            matte_value_into_copy(store, &keys[i], sortArray[i].value);
+        }
+        
+        int type = matte_value_type(keys[i]);
+        if (i == 0) keyType = type;
+        if (type != keyType || (type != MATTE_VALUE_TYPE_NUMBER && type != MATTE_VALUE_TYPE_STRING)) {
+            matte_vm_raise_error_cstring(store->vm, "Sorting without a comparator requires all values to be Numbers or all values to be Strings.");
+            ok = 0;
+            continue;
+        }
+        if (type == MATTE_VALUE_TYPE_NUMBER)
+            sortArray[i].key.number = matte_value_as_number(store, keys[i]);
+        else 
+            sortArray[i].key.string = matte_value_string_get_string_unsafe(store, keys[i]);
+    }
+
+    if (ok) {
+        matteSortCompare_t cmp;
+        if (keyType == MATTE_VALUE_TYPE_NUMBER) 
+            cmp = descending ? matte_value_object_sort__cmp_number_descending : matte_value_object_sort__cmp_number;
+        else 
+            cmp = descending ? matte_value_object_sort__cmp_string_descending : matte_value_object_sort__cmp_string;
+        matte_value_object_sort__apply(store, v, sortArray, len, cmp, NULL);
+    }
+
+    uint32_t n;
+    for(n = 0; n < i; ++n) {
+        matte_store_recycle(store, keys[n]);
+    }
+    matte_deallocate(keys);
+    matte_deallocate(sortArray);
+    matte_value_object_pop_lock(store, v);
 }
 
 
@@ -3827,6 +4471,8 @@ void matte_value_object_insert(
     }
 
     matteObject_t * m = matte_store_bin_fetch_table(store->bin, v.value.id);
+    if (object_frozen_error(store, m)) return;
+    OBJECT_STORAGE_DETACH(store, m);
 
     if (matte_value_type(val) == MATTE_VALUE_TYPE_OBJECT) {    
         object_link_parent_value(store, m, &val);
@@ -3850,17 +4496,23 @@ void matte_value_object_push(
     }
 
     matteObject_t * m = matte_store_bin_fetch_table(store->bin, v.value.id);
+    if (object_frozen_error(store, m)) return;
+    OBJECT_STORAGE_DETACH(store, m);
+    if (!m->table.keyvalues_number) m->table.keyvalues_number = matte_array_create(sizeof(matteValue_t));//(matteArray_t*)matte_pool_fetch(store->keyvalues_numberPool);
+    object_array_push_fast(store, m, val);
+}
 
-    if (matte_value_type(val) == MATTE_VALUE_TYPE_OBJECT) {    
-        object_link_parent_value(store, m, &val);
+void matte_value_object_reserve(matteStore_t * store, matteValue_t v, uint32_t count) {
+    if (matte_value_type(v) != MATTE_VALUE_TYPE_OBJECT) {
+        return;
     }
-    
-    matteValue_t vv = matte_store_new_value(store);
-    matte_value_into_copy(store, &vv, val);
-    if (!m->table.keyvalues_number) m->table.keyvalues_number = matte_array_create(sizeof(matteValue_t));//(matteArray_t*)matte_pool_fetch(store->keyvalues_numberPool);
-    matte_array_push(
-        m->table.keyvalues_number,
-        vv
+    matteObject_t * m = matte_store_bin_fetch_table(store->bin, v.value.id);
+    if (QUERY_STATE(m, OBJECT_STATE__FROZEN)) return;
+    OBJECT_STORAGE_DETACH(store, m);
+    if (!m->table.keyvalues_number) m->table.keyvalues_number = matte_array_create(sizeof(matteValue_t));
+    matte_array_reserve(
+        m->table.keyvalues_number, 
+        matte_array_get_size(m->table.keyvalues_number) + count
     );
 }
 
@@ -3869,6 +4521,8 @@ void matte_value_object_set_table(matteStore_t * store, matteValue_t v, matteVal
         matte_vm_raise_error_cstring(store->vm, "Cannot use object set assignment syntax something that isnt an object.");
         return;
     }
+    if (matte_value_type(v) == MATTE_VALUE_TYPE_OBJECT && !IS_FUNCTION_ID(v.value.id) &&
+        object_frozen_error(store, matte_store_bin_fetch_table(store->bin, v.value.id))) return;
 
     matteValue_t keys = matte_value_object_keys(store, srcTable);
     matte_value_object_push_lock(store, keys);
@@ -3907,6 +4561,29 @@ matteValue_t matte_value_object_set(matteStore_t * store, matteValue_t v, matteV
         return matte_store_new_value(store);
     }
     matteObject_t * m = matte_store_bin_fetch_table(store->bin, v.value.id);
+    if (object_frozen_error(store, m)) return matte_store_new_value(store);
+
+    // Dense fast path: plain objects writing an existing or the next 
+    // number key go straight to the slot. Everything else, including 
+    // sparse writes and negative keys, takes the general path below.
+    if (matte_value_type(key) == MATTE_VALUE_TYPE_NUMBER &&
+        !QUERY_STATE(m, OBJECT_STATE__HAS_INTERFACE | OBJECT_STATE__HAS_LAYOUT) &&
+        (m->table.attribSet == NULL || matte_value_type(*m->table.attribSet) == 0)) {
+        double valNum = matte_value_get_number(key);
+        OBJECT_STORAGE_DETACH(store, m);
+        if (!m->table.keyvalues_number) m->table.keyvalues_number = matte_array_create(sizeof(matteValue_t));
+        uint32_t size = matte_array_get_size(m->table.keyvalues_number);
+        if (valNum >= 0 && valNum < (double)size + 1) {
+            uint32_t index = (uint32_t)valNum;
+            matteValue_t * slot = index == size ? 
+                object_array_push_fast(store, m, value) 
+            :
+                object_array_set_fast(store, m, index, value);
+            matteValue_t out = matte_store_new_value(store);
+            matte_value_into_copy(store, &out, *slot);
+            return out;
+        }
+    }
 
     int hasInterface = QUERY_STATE(m, OBJECT_STATE__HAS_INTERFACE);
     
@@ -4022,6 +4699,7 @@ matteValue_t matte_value_object_set(matteStore_t * store, matteValue_t v, matteV
 
 void matte_value_object_set_index_unsafe(matteStore_t * store, matteValue_t v, uint32_t index, matteValue_t val) {
     matteObject_t * m = matte_store_bin_fetch_table(store->bin, v.value.id);
+    OBJECT_STORAGE_DETACH(store, m);
     matteValue_t * newV = &matte_array_at(m->table.keyvalues_number, matteValue_t, index);
     matteValue_t out = matte_store_new_value(store);
     matte_value_into_copy(store, &out, val);
@@ -4333,7 +5011,8 @@ static void destroy_object(void * d) {
         matte_deallocate(out->function.vars);
     } else {
 
-        if (out->table.keyvalues_id) matte_mvt2_destroy(out->table.keyvalues_id);
+        // shared containers belong to their storage object
+        if (out->table.keyvalues_id && !QUERY_STATE(out, OBJECT_STATE__SHARED_STORAGE)) matte_mvt2_destroy(out->table.keyvalues_id);
     }
 
 }
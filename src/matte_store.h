@@ -167,6 +167,13 @@ void matte_value_into_boolean(matteStore_t *, matteValue_t *, int);
 /// Changes the value into a string with the given state.
 void matte_value_into_string(matteStore_t *, matteValue_t *, const matteString_t *);
 
+/// Same as matte_value_into_string(), but meant for strings that 
+/// live as long as the VM, such as names and constants from bytecode.
+/// When shared strings are enabled (see matte_enable_shared_strings()), 
+/// these are read from one process-wide copy rather than each 
+/// VM interning its own.
+void matte_value_into_string_shared(matteStore_t *, matteValue_t *, const matteString_t *);
+
 /// Changes the value into a new Object with a new lifetime.
 /// Note that obejcts are garbage collected, so they should be used 
 /// or associated with other alive Objects so that it is not 
@@ -298,6 +305,33 @@ matteValue_t matte_value_object_get_interface_private_binding_unsafe(
 /// be used when sure of inputs.
 matteValue_t * matte_value_object_array_at_unsafe(matteStore_t *, matteValue_t v, uint32_t index);
 
+/// Returns whether iterating the object only visits its numbered 
+/// keyed pairs in order: the object is not a function and has no 
+/// attributes, interface, layout, or keys of other types.
+int matte_value_object_is_plain_array(matteStore_t *, matteValue_t v);
+
+/// Makes an empty target object share the contents of src without copying 
+/// them. The shared contents are copied on the first write to either object.
+/// Returns 1 if the objects now share their contents. Returns 0 and leaves 
+/// both unchanged if either object is not a plain object, if target has 
+/// any contents, or if src is small enough that a copy is cheaper.
+int matte_value_object_share_into(matteStore_t *, matteValue_t target, matteValue_t src);
+
+/// Sets every key-value pair of src within target, as spreading an 
+/// object does, reading them in place. This is only done for objects 
+/// with no attributes, interface or layout, where nothing can run 
+/// while copying. Returns whether the copy was done.
+int matte_value_object_spread_into(matteStore_t *, matteValue_t target, matteValue_t src);
+
+/// Freezes the object and every object it refers to. Frozen objects 
+/// raise an error when modified, are skipped by the garbage collector 
+/// and are kept until the store is destroyed. Raises an error and 
+/// freezes nothing if a function can be reached from the object.
+void matte_value_object_freeze(matteStore_t *, matteValue_t v);
+
+/// Returns whether the value is a frozen object.
+int matte_value_object_is_frozen(matteStore_t *, matteValue_t v);
+
 /// Under the assumption that value is a string, returns the internally
 /// kept string reference. This is significantly faster for the string 
 /// case, as a new string object does not need to be created.
@@ -429,12 +463,25 @@ void matte_value_object_push(
     matteValue_t val
 );
 
+/// Hints that count more number keys are about to be appended to the 
+/// object, so that pushing them does not reallocate along the way.
+/// Only the allocation changes; the object's contents are untouched.
+/// Does nothing if the value is not an object.
+void matte_value_object_reserve(matteStore_t *, matteValue_t, uint32_t count);
+
 
 /// Sorts the number key contents of the object.
 /// less is expected to be a function that takes 2 arguments, "a", and "b", and returns 
 /// a comparison between them (-1 | 0 | 1)
+/// The sort is stable.
 void matte_value_object_sort_unsafe(matteStore_t *, matteValue_t, matteValue_t less);
 
+/// Sorts the number key contents of the object without calling into the VM.
+/// If by is empty, the values themselves are compared, else the value 
+/// at the key by within each value is compared. The compared values 
+/// must either all be Numbers or all be Strings. The sort is stable.
+void matte_value_object_sort_native_unsafe(matteStore_t *, matteValue_t, matteValue_t by, int descending);
+
 /// Attempts to run a VM call for each key-value pair within the object.
 void matte_value_object_foreach(matteStore_t *, matteValue_t object, matteValue_t function);
 
@@ -553,6 +600,21 @@ const matteValue_t * matte_store_get_nullable_type(matteStore_t *);
 /// This is normally not needed by user code.
 const matteValue_t ** matte_value_object_function_activate_closure(matteStore_t *, matteValue_t v, matteValue_t * refs);
 
+/// Like matte_value_object_function_activate_closure(), but for functions 
+/// whose referrables are never captured. The referrables stay owned 
+/// by the caller and are not linked to the function, so the caller 
+/// is responsible for keeping any objects within them alive.
+/// matte_value_object_function_deactivate_closure() must be called 
+/// before the referrables are released.
+///
+/// This is normally not needed by user code.
+const matteValue_t ** matte_value_object_function_activate_closure_detached(matteStore_t *, matteValue_t v, matteValue_t * refs);
+
+/// Detaches referrables given by matte_value_object_function_activate_closure_detached().
+///
+/// This is normally not needed by user code.
+void matte_value_object_function_deactivate_closure(matteStore_t *, matteValue_t v);
+
 
 
 
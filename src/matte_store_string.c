@@ -29,7 +29,6 @@ DEALINGS IN THE SOFTWARE.
 */
 #include "matte_store_string.h"
 #include "matte_string.h"
-#include "matte_table.h"
 #include "matte_string.h"
 #include "matte_array.h"
 #include "matte.h"
@@ -41,40 +40,283 @@ DEALINGS IN THE SOFTWARE.
 #endif
 
 
+#define string_store_bucket_start_size 64
+// Number of unreferenced strings kept around in case 
+// they are needed again soon.
+#define string_store_quarantine_size 256
+
 typedef struct {
     matteString_t * str;
     uint32_t refs;
     uint32_t id;
+    // cached hash of str so that bucket walks can reject 
+    // mismatches without touching the string itself.
+    uint32_t hash;
+    // next string ID within the same bucket, 0 if none.
+    uint32_t next;
+    // whether the ID is within the quarantine.
+    uint32_t quarantined;
 } matteStringInfo_t;
 
 struct matteStringStore_t{
-    // C-string to id
-    matteTable_t * strbufferToID;
+    // hash bucket -> first string ID within the bucket.
+    // Chains continue through matteStringInfo_t.next. The 
+    // bucket count is always a power of 2.
+    matteArray_t * buckets;
+    // number of live strings within the buckets.
+    uint32_t count;
     // matteStringInfo_t
     matteArray_t * strings;
     matteArray_t * deadIDs;
+    // reused to look up C-strings.
+    matteString_t * cstringTemp;
+    // IDs whose strings have run out of references, oldest first 
+    // from quarantineIter. They stay findable and are revived if 
+    // referenced again, and are only reclaimed once pushed out.
+    uint32_t quarantine[string_store_quarantine_size];
+    uint32_t quarantineIter;
+    uint32_t quarantineCount;
+    // Per-store views of shared strings, indexed by shared index.
+    // Created on first find so that lazily-cached string state 
+    // is never written to by more than one thread.
+    matteArray_t * sharedViews;
 } ;
 
 
+
+
+//////////////////// Shared strings
+//
+// The shared table is process-wide and append-only: strings 
+// placed within it are never modified or removed, so readers 
+// need no locks. Entries live in fixed-size chunks that never 
+// move, and each bucket is the head of a chain that is only 
+// ever prepended to with a compare-and-swap.
+//
+// Shared string IDs are the shared index with 
+// string_shared_id_bit set, keeping them distinct from 
+// the IDs of each store's own strings.
+
+#define string_shared_id_bit 0x80000000
+#define string_shared_chunk_size 4096
+#define string_shared_chunk_count 1024
+#define string_shared_bucket_count 16384
+
+typedef struct {
+    matteString_t * str;
+    uint32_t hash;
+    // next shared index within the same bucket, 0 if none.
+    uint32_t next;
+} matteStringSharedEntry_t;
+
+static struct {
+    // NULL until enabled.
+    uint32_t * buckets;
+    matteStringSharedEntry_t * chunks[string_shared_chunk_count];
+    // next index to claim. Index 0 is never used.
+    uint32_t next;
+} sharedStrings = {NULL, {}, 1};
+
+
+static matteStringSharedEntry_t * string_shared_entry(uint32_t index) {
+    matteStringSharedEntry_t * chunk = __atomic_load_n(&sharedStrings.chunks[index / string_shared_chunk_size], __ATOMIC_ACQUIRE);
+    return chunk + (index % string_shared_chunk_size);
+}
+
+// Walks a shared chain from the given index until the stop index.
+// Returns the index of the equivalent string or 0 if none.
+static uint32_t string_shared_walk(uint32_t index, uint32_t stop, const matteString_t * str, uint32_t hash) {
+    while(index != stop) {
+        const matteStringSharedEntry_t * entry = string_shared_entry(index);
+        if (entry->hash == hash && matte_string_test_eq(entry->str, str))
+            return index;
+        index = entry->next;
+    }
+    return 0;
+}
+
+static uint32_t string_shared_lookup(uint32_t * buckets, const matteString_t * str, uint32_t hash) {
+    uint32_t head = __atomic_load_n(buckets + (hash % string_shared_bucket_count), __ATOMIC_ACQUIRE);
+    return string_shared_walk(head, 0, str, hash);
+}
+
+// Returns the shared index of the string, adding it if needed.
+// Returns 0 if the table is full.
+static uint32_t string_shared_intern(uint32_t * buckets, const matteString_t * str, uint32_t hash) {
+    uint32_t index = string_shared_lookup(buckets, str, hash);
+    if (index) return index;
+
+    index = __atomic_fetch_add(&sharedStrings.next, 1, __ATOMIC_RELAXED);
+    if (index >= string_shared_chunk_size * string_shared_chunk_count) return 0;
+
+    matteStringSharedEntry_t ** chunk = &sharedStrings.chunks[index / string_shared_chunk_size];
+    if (!__atomic_load_n(chunk, __ATOMIC_ACQUIRE)) {
+        matteStringSharedEntry_t * expected = NULL;
+        matteStringSharedEntry_t * newChunk = (matteStringSharedEntry_t*)matte_allocate(sizeof(matteStringSharedEntry_t) * string_shared_chunk_size);
+        if (!__atomic_compare_exchange_n(chunk, &expected, newChunk, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            matte_deallocate(newChunk);
+    }
+
+    // all lazily-cached state is populated before the entry 
+    // is visible to other threads.
+    matteStringSharedEntry_t * entry = string_shared_entry(index);
+    entry->str = matte_string_clone(str);
+    entry->hash = hash;
+    matte_string_get_c_str(entry->str);
+    matte_string_get_hash(entry->str);
+
+    uint32_t * bucket = buckets + (hash % string_shared_bucket_count);
+    uint32_t head = __atomic_load_n(bucket, __ATOMIC_ACQUIRE);
+    for(;;) {
+        entry->next = head;
+        if (__atomic_compare_exchange_n(bucket, &head, index, 0, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE))
+            return index;
+        
+        // another thread prepended to the chain first. It may 
+        // have added the same string, in which case ours is dropped.
+        uint32_t other = string_shared_walk(head, entry->next, str, hash);
+        if (other) {
+            matte_string_destroy(entry->str);
+            entry->str = NULL;
+            return other;
+        }
+    }
+}
+
+void matte_string_store_enable_shared() {
+    if (__atomic_load_n(&sharedStrings.buckets, __ATOMIC_ACQUIRE)) return;
+    uint32_t * expected = NULL;
+    uint32_t * buckets = (uint32_t*)matte_allocate(sizeof(uint32_t) * string_shared_bucket_count);
+    if (!__atomic_compare_exchange_n(&sharedStrings.buckets, &expected, buckets, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        matte_deallocate(buckets);
+}
+
+static const matteString_t * string_store_find_shared(const matteStringStore_t * hc, uint32_t id) {
+    matteStringStore_t * h = (matteStringStore_t*)hc;
+    uint32_t index = id & ~string_shared_id_bit;
+    if (index == 0 || index >= __atomic_load_n(&sharedStrings.next, __ATOMIC_RELAXED)) return NULL;
+
+    uint32_t len = matte_array_get_size(h->sharedViews);
+    if (index >= len) {
+        matte_array_set_size(h->sharedViews, index+1);
+        memset(&matte_array_at(h->sharedViews, matteString_t *, len), 0, (index+1-len)*sizeof(matteString_t *));
+    }
+    matteString_t ** view = &matte_array_at(h->sharedViews, matteString_t *, index);
+    if (!*view) {
+        const matteStringSharedEntry_t * entry = string_shared_entry(index);
+        if (!entry->str) return NULL;
+        *view = matte_string_create_view(entry->str);
+    }
+    return *view;
+}
+
+
+
+////////////////////
+
+
+
+static void string_store_rehash(matteStringStore_t * h, uint32_t nBuckets) {
+    matte_array_set_size(h->buckets, nBuckets);
+    uint32_t * buckets = (uint32_t*)matte_array_get_data(h->buckets);
+    memset(buckets, 0, nBuckets*sizeof(uint32_t));
+
+    matteStringInfo_t * infos = (matteStringInfo_t*)matte_array_get_data(h->strings);
+    uint32_t i;
+    uint32_t len = matte_array_get_size(h->strings);
+    for(i = 1; i < len; ++i) {
+        matteStringInfo_t * info = infos+i;
+        if (!info->str) continue;
+        uint32_t bucket = info->hash & (nBuckets-1);
+        info->next = buckets[bucket];
+        buckets[bucket] = i;
+    }
+}
+
+// Returns the ID of the string equivalent to str or 0 if none.
+static uint32_t string_store_lookup(const matteStringStore_t * h, const matteString_t * str, uint32_t hash) {
+    const matteStringInfo_t * infos = (matteStringInfo_t*)matte_array_get_data(h->strings);
+    uint32_t id = matte_array_at(h->buckets, uint32_t, hash & (matte_array_get_size(h->buckets)-1));
+    while(id) {
+        const matteStringInfo_t * info = infos+id;
+        if (info->hash == hash && matte_string_test_eq(info->str, str))
+            return id;
+        id = info->next;
+    }
+    return 0;
+}
+
+static void string_store_unlink(matteStringStore_t * h, matteStringInfo_t * ref) {
+    matteStringInfo_t * infos = (matteStringInfo_t*)matte_array_get_data(h->strings);
+    uint32_t * iter = &matte_array_at(h->buckets, uint32_t, ref->hash & (matte_array_get_size(h->buckets)-1));
+    while(*iter != ref->id) {
+        iter = &infos[*iter].next;
+    }
+    *iter = ref->next;
+    ref->next = 0;
+    h->count--;
+}
+
+static void string_store_reclaim(matteStringStore_t * h, matteStringInfo_t * ref) {
+    #ifdef MATTE_DEBUG__STORE
+        printf("STRING %d DONE\n", ref->id);
+    #endif    
+    string_store_unlink(h, ref);
+    matte_string_destroy(ref->str);
+    ref->str = NULL;
+    matte_array_push(h->deadIDs, ref->id);
+}
+
+// Places an unreferenced string into the quarantine, 
+// reclaiming the oldest entry if the quarantine is full.
+static void string_store_quarantine(matteStringStore_t * h, matteStringInfo_t * ref) {
+    if (ref->quarantined) return;
+    uint32_t * slot = h->quarantine + h->quarantineIter;
+    h->quarantineIter = (h->quarantineIter + 1) % string_store_quarantine_size;
+    if (h->quarantineCount == string_store_quarantine_size) {
+        matteStringInfo_t * old = &matte_array_at(h->strings, matteStringInfo_t, *slot);
+        old->quarantined = 0;
+        // may have been revived since.
+        if (old->refs == 0)
+            string_store_reclaim(h, old);
+    } else {
+        h->quarantineCount++;
+    }
+    // reclaiming can only push to deadIDs, so ref is still valid.
+    ref->quarantined = 1;
+    *slot = ref->id;
+}
+
+
 matteStringStore_t * matte_string_store_create() {
     matteStringStore_t * h = (matteStringStore_t*)matte_allocate(sizeof(matteStringStore_t));
     h->strings = matte_array_create(sizeof(matteStringInfo_t));
-    h->strbufferToID = matte_table_create_hash_c_string();
+    h->buckets = matte_array_create(sizeof(uint32_t));
     h->deadIDs = matte_array_create(sizeof(uint32_t));
+    h->cstringTemp = matte_string_create();
+    h->sharedViews = matte_array_create(sizeof(matteString_t *));
     matteStringInfo_t dummy = {};
     matte_array_push(h->strings, dummy);
+    string_store_rehash(h, string_store_bucket_start_size);
     return h;
 }
 
 uint32_t matte_string_store_ref(matteStringStore_t * h, const matteString_t * str) {
-    return matte_string_store_ref_cstring(h, matte_string_get_c_str(str));
-}
-uint32_t matte_string_store_ref_cstring(matteStringStore_t * h, const char * strc) {
-    uint32_t id = (uintptr_t) matte_table_find(h->strbufferToID, strc);
+    uint32_t hash = matte_string_get_hash(str);
+    uint32_t id = string_store_lookup(h, str, hash);
     if (id == 0) {
+        // strings already within this store always take priority 
+        // so that a string never has 2 IDs within the same store.
+        uint32_t * shared = __atomic_load_n(&sharedStrings.buckets, __ATOMIC_ACQUIRE);
+        if (shared) {
+            uint32_t index = string_shared_lookup(shared, str, hash);
+            if (index) return index | string_shared_id_bit;
+        }
+
         matteStringInfo_t val = {};
-        val.str = matte_string_create_from_c_str("%s", strc);
+        val.str = matte_string_clone(str);
         val.refs = 0;
+        val.hash = hash;
 
         if (h->deadIDs->size) {
             id = matte_array_at(h->deadIDs, uint32_t, h->deadIDs->size-1);
@@ -86,21 +328,46 @@ uint32_t matte_string_store_ref_cstring(matteStringStore_t * h, const char * str
             val.id = id;
             matte_array_push(h->strings, val);
         }
-        matte_table_insert(h->strbufferToID, strc, (void*)(uintptr_t)id);
-
-
 
+        uint32_t nBuckets = matte_array_get_size(h->buckets);
+        if (++h->count > nBuckets) {
+            string_store_rehash(h, nBuckets*2);
+        } else {
+            uint32_t * bucket = &matte_array_at(h->buckets, uint32_t, hash & (nBuckets-1));
+            matte_array_at(h->strings, matteStringInfo_t, id).next = *bucket;
+            *bucket = id;
+        }
     } 
     matte_array_at(h->strings, matteStringInfo_t, id).refs++;
     return id;
 }
+uint32_t matte_string_store_ref_shared(matteStringStore_t * h, const matteString_t * str) {
+    uint32_t * shared = __atomic_load_n(&sharedStrings.buckets, __ATOMIC_ACQUIRE);
+    if (shared) {
+        uint32_t hash = matte_string_get_hash(str);
+        uint32_t id = string_store_lookup(h, str, hash);
+        if (id == 0) {
+            uint32_t index = string_shared_intern(shared, str, hash);
+            if (index) return index | string_shared_id_bit;
+        }
+    }
+    return matte_string_store_ref(h, str);
+}
+
+uint32_t matte_string_store_ref_cstring(matteStringStore_t * h, const char * strc) {
+    matte_string_clear(h->cstringTemp);
+    matte_string_concat_c_str(h->cstringTemp, strc);
+    return matte_string_store_ref(h, h->cstringTemp);
+}
 
 void matte_string_store_ref_id(matteStringStore_t * h, uint32_t id) {
+    // shared strings are permanent; also covers this case.
     if (id >= matte_array_get_size(h->strings)) return;
     matte_array_at(h->strings, matteStringInfo_t, id).refs++;
 }
 
 void matte_string_store_unref(matteStringStore_t * h, uint32_t id) {
+    if (id & string_shared_id_bit) return;
     if (id >= matte_array_get_size(h->strings)) {
         #ifdef MATTE_DEBUG__STORE
             assert(!"Invalid string unrefd");
@@ -117,13 +384,7 @@ void matte_string_store_unref(matteStringStore_t * h, uint32_t id) {
 
     ref->refs--;        
     if (ref->refs == 0) {
-        #ifdef MATTE_DEBUG__STORE
-            printf("STRING %d DONE\n", id);
-        #endif    
-        matte_table_remove(h->strbufferToID, matte_string_get_c_str(ref->str));
-        matte_string_destroy(ref->str);
-        ref->str = NULL;
-        matte_array_push(h->deadIDs, id);
+        string_store_quarantine(h, ref);
     }
 }
 
@@ -135,14 +396,22 @@ void matte_string_store_destroy(matteStringStore_t * h) {
         matteString_t * s = matte_array_at(h->strings, matteStringInfo_t, i).str;
         if (s) matte_string_destroy(s);
     }
+    len = matte_array_get_size(h->sharedViews);
+    for(i = 0; i < len; ++i) {
+        matteString_t * s = matte_array_at(h->sharedViews, matteString_t *, i);
+        if (s) matte_string_destroy(s);
+    }
+    matte_array_destroy(h->sharedViews);
     matte_array_destroy(h->strings);
-    matte_table_destroy(h->strbufferToID);
+    matte_array_destroy(h->buckets);
     matte_array_destroy(h->deadIDs);
+    matte_string_destroy(h->cstringTemp);
     matte_deallocate(h);
 }
 
 
 const matteString_t * matte_string_store_find(const matteStringStore_t * h, uint32_t i) {
+    if (i & string_shared_id_bit) return string_store_find_shared(h, i);
     if (i >= matte_array_get_size(h->strings)) return NULL;
     return matte_array_at(h->strings, matteStringInfo_t, i).str;
 }
@@ -152,7 +421,7 @@ void matte_string_store_print(matteStringStore_t * h) {
     uint32_t i;
     uint32_t len = matte_array_get_size(h->strings);
     for(i = 0; i < len; ++i) {
-        matteString_t * str = matte_array_at(h->strings, matteString_t *, i);
+        matteString_t * str = matte_array_at(h->strings, matteStringInfo_t, i).str;
         if (str)
             printf("%d  | %s\n", i, matte_string_get_c_str(str));
     }
@@ -45,6 +45,20 @@ void matte_string_store_destroy(matteStringStore_t *);
 /// The ID pointing to the string is returned.
 uint32_t matte_string_store_ref(matteStringStore_t *, const matteString_t *);
 
+/// Same as matte_string_store_ref(), but for strings that are never 
+/// expected to be released, such as those loaded from bytecode.
+/// If the shared string table is enabled and the string is not already 
+/// within this store, the string is placed in the shared table 
+/// instead, where all stores can use it without their own copy.
+uint32_t matte_string_store_ref_shared(matteStringStore_t *, const matteString_t *);
+
+/// Enables the process-wide shared string table used by 
+/// matte_string_store_ref_shared(). Safe to call from any thread 
+/// and more than once. Once enabled, it cannot be disabled, and its 
+/// strings persist until the process exits.
+/// Lookups within the shared table are lock-free.
+void matte_string_store_enable_shared();
+
 /// same as matte_string_store_ref(), but accepts a c string for convenience
 uint32_t matte_string_store_ref_cstring(matteStringStore_t *, const char *);
 
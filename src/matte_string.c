@@ -52,10 +52,34 @@ struct matteString_t {
 
     // temporary cstring copy only populated when requested
     char * cstrtemp;
+    // byte length of cstrtemp, valid while cstrtemp is set.
+    uint32_t cstrlen;
+
+    // cached result of matte_string_get_hash(), valid while hashValid is set.
+    uint32_t hash;
+    int hashValid;
     matteString_t * lastSubstr;
+
+    // If set, utf8 and cstrtemp are borrowed from another string 
+    // and are neither modified nor freed by this one.
+    int isView;
 };
 
 
+// Called whenever the contents of the string change to drop 
+// any data derived from the previous contents.
+static void matte_string_invalidate(matteString_t * s) {
+    #ifdef MATTE_DEBUG
+        assert(!s->isView && "Shared string views are read-only.");
+    #endif
+    if (s->cstrtemp) {
+        matte_deallocate(s->cstrtemp);
+        s->cstrtemp = NULL;
+    }
+    s->hashValid = 0;
+}
+
+
 static uint32_t utf8_next_char(uint8_t ** source) {
     uint8_t * iter = *source;
     uint32_t val = (*source)[0];
@@ -121,10 +145,7 @@ static void matte_string_concat_cstr(matteString_t * s, const uint8_t * cstr, ui
         }
     } while(val);
     
-    if (s->cstrtemp) {
-        matte_deallocate(s->cstrtemp);
-        s->cstrtemp = NULL;
-    }
+    matte_string_invalidate(s);
 }
 
 static void matte_string_set_cstr(matteString_t * s, const uint8_t * cstr, uint32_t len) {
@@ -177,26 +198,35 @@ matteString_t * matte_string_clone(const matteString_t * src) {
     return out;
 }
 
+matteString_t * matte_string_create_view(const matteString_t * src) {
+    matteString_t * out = (matteString_t*)matte_allocate(sizeof(matteString_t));
+    out->utf8 = src->utf8;
+    out->len = src->len;
+    out->alloc = src->alloc;
+    out->cstrtemp = (char*)matte_string_get_c_str(src);
+    out->cstrlen = src->cstrlen;
+    out->hash = matte_string_get_hash(src);
+    out->hashValid = 1;
+    out->isView = 1;
+    return out;
+}
+
 void matte_string_destroy(matteString_t * s) {
-    matte_deallocate(s->cstrtemp);
-    matte_deallocate(s->utf8);
+    if (!s->isView) {
+        matte_deallocate(s->cstrtemp);
+        matte_deallocate(s->utf8);
+    }
     if (s->lastSubstr) matte_string_destroy(s->lastSubstr);
     matte_deallocate(s);
 }
 
 void matte_string_clear(matteString_t * s) {
     s->len = 0;
-    if (s->cstrtemp) {
-        matte_deallocate(s->cstrtemp);
-        s->cstrtemp = NULL;
-    }
+    matte_string_invalidate(s);
 }
 
 void matte_string_set(matteString_t * s, const matteString_t * src) {
-    if (s->cstrtemp) {
-        matte_deallocate(s->cstrtemp);
-        s->cstrtemp = NULL;
-    }
+    matte_string_invalidate(s);
     if (s->alloc > src->len) {
         memcpy(s->utf8, src->utf8, src->len*sizeof(uint32_t));
         s->len = src->len;
@@ -207,8 +237,8 @@ void matte_string_set(matteString_t * s, const matteString_t * src) {
         s->utf8 = (uint32_t*)matte_allocate(s->len*sizeof(uint32_t));
         memcpy(s->utf8, src->utf8, src->len*sizeof(uint32_t));
     }
-
-
+    s->hash = src->hash;
+    s->hashValid = src->hashValid;
 }
 
 
@@ -231,12 +261,26 @@ void matte_string_concat_printf(matteString_t * s, const char * format, ...) {
     matte_deallocate(newBuffer);
 }
 
+void matte_string_concat_c_str(matteString_t * s, const char * cstr) {
+    matte_string_concat_cstr(s, (const uint8_t*)cstr, strlen(cstr));
+}
+
 void matte_string_concat(matteString_t * s, const matteString_t * src) {
-    uint32_t i;
     uint32_t len = src->len;
-    for(i = 0; i < len; ++i) {
-        matte_string_append_char(s, src->utf8[i]);
+    if (!len) return;
+    if (s->len + len >= s->alloc) {
+        uint32_t alloc = s->alloc < prealloc_size ? prealloc_size : s->alloc;
+        while(s->len + len >= alloc) alloc *= 1.4;
+        uint32_t * newData = (uint32_t*)matte_allocate(alloc*sizeof(uint32_t));
+        memcpy(newData, s->utf8, s->len*sizeof(uint32_t));
+        matte_deallocate(s->utf8);
+        s->utf8 = newData;
+        s->alloc = alloc;
     }
+    // src may be s
+    memmove(s->utf8 + s->len, src->utf8, len*sizeof(uint32_t));
+    s->len += len;
+    matte_string_invalidate(s);
 }
 
 
@@ -256,10 +300,7 @@ const matteString_t * matte_string_get_substr(
         ((matteString_t *)s)->lastSubstr = matte_string_create();
     }
 
-    if (s->lastSubstr->cstrtemp) {
-        matte_deallocate(s->lastSubstr->cstrtemp);
-        s->lastSubstr->cstrtemp = NULL;
-    }
+    matte_string_invalidate(s->lastSubstr);
     // invalid
     if (to < from) {
         s->lastSubstr->len = 0;
@@ -295,6 +336,7 @@ const char * matte_string_get_c_str(const matteString_t * tsrc) {
             iter += utf8_put_char(val, iter);
         }
         *iter = 0;
+        t->cstrlen = iter - (uint8_t*)t->cstrtemp;
     }
     return tsrc->cstrtemp;
 }
@@ -310,10 +352,7 @@ uint32_t matte_string_get_char(const matteString_t * t, uint32_t p) {
 
 void matte_string_set_char(matteString_t * t, uint32_t p, uint32_t value) {
     if (p >= t->len) return;
-    if (t->cstrtemp) {
-        matte_deallocate(t->cstrtemp);
-        t->cstrtemp = NULL;
-    }
+    matte_string_invalidate(t);
     t->utf8[p] = value;
 
 }
@@ -327,10 +366,7 @@ void matte_string_append_char(matteString_t * t, uint32_t value) {
         matte_deallocate(t->utf8);
         t->utf8 = newData;
     }
-    if (t->cstrtemp) {
-        matte_deallocate(t->cstrtemp);
-        t->cstrtemp = NULL;
-    }
+    matte_string_invalidate(t);
 
     t->utf8[t->len++] = value;
 }
@@ -350,10 +386,7 @@ void matte_string_insert_n_chars(
         matte_deallocate(t->utf8);
         t->utf8 = newData;
     }
-    if (t->cstrtemp) {
-        matte_deallocate(t->cstrtemp);
-        t->cstrtemp = NULL;
-    }
+    matte_string_invalidate(t);
 
     uint32_t i;
     uint32_t len = nvalues;
@@ -375,10 +408,7 @@ void matte_string_remove_n_chars(
     uint32_t nvalues
 ) {
     if (position >= t->len) return;
-    if (t->cstrtemp) {
-        matte_deallocate(t->cstrtemp);
-        t->cstrtemp = NULL;
-    }
+    matte_string_invalidate(t);
     
     if (position + nvalues >= t->len) {
         matte_string_truncate(t, position);
@@ -394,10 +424,7 @@ void matte_string_remove_n_chars(
 
 uint32_t matte_string_get_utf8_length(const matteString_t * t) {
     matte_string_get_c_str(t);
-    uint8_t * c = (uint8_t*)t->cstrtemp;
-    uint32_t length = 0;
-    while(*c) {length++; c++;}
-    return length;
+    return t->cstrlen;
 }
 
 void * matte_string_get_utf8_data(const matteString_t * t) {
@@ -422,15 +449,13 @@ void matte_string_append_utf8_char(
 
     s->utf8[s->len++] = val;
     
-    if (s->cstrtemp) {
-        matte_deallocate(s->cstrtemp);
-        s->cstrtemp = NULL;
-    }
+    matte_string_invalidate(s);
 }
 
 uint32_t matte_string_get_hash(
     const matteString_t * s
 ) {
+    if (s->hashValid) return s->hash;
     uint32_t * data = s->utf8;
     uint32_t hash = 5381;
 
@@ -438,6 +463,8 @@ uint32_t matte_string_get_hash(
     for(i = 0; i < s->len; ++i, ++data) {
         hash = (hash<<5) + hash + *data;
     } 
+    ((matteString_t*)s)->hash = hash;
+    ((matteString_t*)s)->hashValid = 1;
     return hash;
 }
 
@@ -470,6 +497,7 @@ int matte_string_test_contains(const matteString_t * a, const matteString_t * b)
 
 int matte_string_test_eq(const matteString_t * a, const matteString_t * b) {
     if (a->len != b->len) return 0;
+    if (a->hashValid && b->hashValid && a->hash != b->hash) return 0;
     uint32_t i;
     uint32_t * aiter = a->utf8;
     uint32_t * biter = b->utf8;
@@ -624,6 +652,7 @@ void matte_string_truncate(
 ) {
     if (newLen < str->len) {
         str->len = newLen;
+        matte_string_invalidate(str);
     }
 }
 
@@ -70,6 +70,19 @@ matteString_t * matte_string_clone(
     const matteString_t * str
 );
 
+/// Creates a new, read-only string that refers to the character 
+/// data of the given string instead of copying it. Meant for 
+/// sharing immutable strings between threads: the view's own 
+/// cached state (such as substrings) is kept separate from 
+/// the source. The source must not be modified or destroyed 
+/// while the view exists, and its C-string and hash are 
+/// computed if they are not already.
+///
+matteString_t * matte_string_create_view(
+    /// The string to refer to.
+    const matteString_t * src
+);
+
 /// Creates a new base64-encoded string from a raw byte buffer.
 /// This then can be used with matte_string_decode_base64() to retrieve 
 /// a raw byte buffer once more.
@@ -140,6 +153,19 @@ void matte_string_concat_printf(
 );
 
 
+/// Adds the given UTF8 C-string to the end of the given string.
+/// Unlike matte_string_concat_printf(), the C-string is 
+/// copied as-is rather than used as a format.
+///
+void matte_string_concat_c_str(
+    /// The string to add to.
+    matteString_t * str,
+    
+    /// The C-string to copy from.
+    const char * cstr
+);
+
+
 /// Reduces the length of the string in characters.
 /// If the new length is larger, no action is taken.
 ///
@@ -246,6 +272,7 @@ void matte_string_remove_n_chars(
 /// Gets the byte length of the data representation 
 /// of this string in UTF8. Depending on the context, this could 
 /// match the length of the string, or it could be wider.
+/// The length is cached until the string is next modified.
 ///
 uint32_t matte_string_get_utf8_length(
     /// the string to query.
@@ -275,7 +302,8 @@ void matte_string_append_utf8_char(
 );
 
 // Gets a 32bit hash representing 
-// the string.
+// the string. The hash is cached until 
+// the string is next modified.
 uint32_t matte_string_get_hash(
     const matteString_t * str
 );
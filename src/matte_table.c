@@ -54,6 +54,8 @@ DEALINGS IN THE SOFTWARE.
 typedef struct matteTableEntry_t matteTableEntry_t;
 struct matteTableEntry_t {
     int keyLen;
+    // full hash of the key, compared before the key itself
+    uint32_t hash;
     void * value;
     void * key;
 };
@@ -258,9 +260,7 @@ static void matte_table_resize(matteTable_t * t) {
         bucket = buckets+i;
         for(n = 0; n < bucket->size; ++n) {
             entry = bucket->entries+n;
-            uint32_t keyLen = t->keyLen == -1 ? strlen((char*)entry->key)+1 : t->keyLen == -2 ? 0 : t->keyLen;
-            uint32_t hash = t->hash(entry->key, keyLen);
-            index = hash_to_index(t, hash);
+            index = hash_to_index(t, entry->hash);
 
             matteTableBucket_t * next = t->buckets+index;
             if (next->size == table_bucket_fill_amount)
@@ -305,6 +305,7 @@ static matteTableEntry_t matte_table_new_entry(matteTable_t * t, const void * ke
 
     out.value = value;
     out.keyLen = keyLen;
+    out.hash = hash;
     // if the key is dynamically allocated, we need a local copy 
     if (keyLen) {    
         out.key = matte_allocate(keyLen);
@@ -382,8 +383,8 @@ void matte_table_insert(matteTable_t * t, const void * key, void * value) {
     // look for preexisting entry
     for(i = 0; i < bucketLen; ++i) {
         matteTableEntry_t * next = src->entries+i;
-        if (next->keyLen == keyLen) { // hash must equal before key does, so 
-                                 // this is an easy check
+        if (next->hash == hash && next->keyLen == keyLen) { // hash must equal before key does, so 
+                                                            // this is an easy check
             if (t->keyCmp(key, next->key, next->keyLen)) {
                 // update data for key
                 next->value = value;
@@ -438,8 +439,8 @@ void * matte_table_find(const matteTable_t * t, const void * key) {
     uint32_t i;
     for(i = 0; i < bucket->size; ++i) {
         next = bucket->entries+i;
-        if (next->keyLen == keyLen) { // hash must equal before key does, so 
-                                 // this is an easy check
+        if (next->hash == hash && next->keyLen == keyLen) { // hash must equal before key does, so 
+                                                            // this is an easy check
             if (t->keyCmp(key, next->key, next->keyLen)) {
                 return next->value;
             }
@@ -475,7 +476,7 @@ int matte_table_entry_exists(const matteTable_t * t, const void * key) {
     uint32_t i;
     for(i = 0; i < bucket->size; ++i) {
         next = bucket->entries+i;
-        if (next->keyLen == keyLen) { // hash must equal before key does, so 
+        if (next->hash == hash && next->keyLen == keyLen) { // hash must equal before key does, so 
             if (t->keyCmp(key, next->key, next->keyLen)) {
                 return TRUE;
             }
@@ -500,7 +501,7 @@ void matte_table_remove(matteTable_t * t, const void * key) {
     uint32_t i;
     for(i = 0; i < bucket->size; ++i) {
         next = bucket->entries+i;
-        if (next->keyLen == keyLen) { // hash must equal before key does, so 
+        if (next->hash == hash && next->keyLen == keyLen) { // hash must equal before key does, so 
             if (t->keyCmp(key, next->key, next->keyLen)) {
                 t->keyRemove(next->key);
                 t->size--;
@@ -37,20 +37,28 @@ DEALINGS IN THE SOFTWARE.
 #include "matte.h"
 #include "matte_compiler.h"
 #include "matte.h"
+#include "matte_number.h"
+#include "matte_format.h"
 #include "./rom/native.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include <assert.h>
+#include <time.h>
 
 
 #define matte_string_temp_max_calls 128
+#define matte_vm_format_cache_max 256
 struct matteVM_t {
     matte_t * matte;
 
     // stubIndex[fileid] -> [stubid]
     matteTable_t * stubIndex;
 
+    // fileid -> matteVMPendingBytecode_t *, for files 
+    // whose stubs have not been decoded yet.
+    matteTable_t * pendingBytecode;
+
     // topmost: current frame
     matteArray_t * callstack;
     
@@ -124,6 +132,21 @@ struct matteVM_t {
     matteString_t * string_tempVals[matte_string_temp_max_calls];
     int string_tempIter;
 
+    // format strings used with the format query, 
+    // string id -> matteVMFormatCacheEntry_t *
+    matteTable_t * formatCache;
+    // reused item list and output for the format query.
+    matteArray_t * formatItems;
+    matteString_t * formatOutput;
+
+    // when profiling, counts of each executed opcode pair,
+    // indexed by [previous * 256 + next].
+    uint64_t * opcodePairs;
+    int opcodeLast;
+
+    // xoshiro256** state for Number.random and friends.
+    uint64_t randomState[4];
+
     // for parts of the implementation that request it, 
     // if these are set, the next pushed stackframe will contain 
     // these as the restart condition dataset.
@@ -157,6 +180,13 @@ typedef struct {
 } MatteCleanupFunctionSet;
 
 
+typedef struct {
+    // held so that the string's id stays in use while cached.
+    matteValue_t src;
+    matteFormat_t * format;
+} matteVMFormatCacheEntry_t;
+
+
 #ifdef MATTE_DEBUG
 
 void matte_vm_find_in_stack(matteVM_t * vm, uint32_t id) {
@@ -373,6 +403,7 @@ static matteVMStackFrame_t * vm_push_frame(matteVM_t * vm) {
             // initialize
             frame->referrablesSet = NULL;
             frame->referrableCount = 0;
+            frame->ownsReferrables = 0;
             frame->captures = NULL;;
             frame->pc = 0;
             frame->prettyName = matte_string_create();
@@ -390,6 +421,7 @@ static matteVMStackFrame_t * vm_push_frame(matteVM_t * vm) {
         frame->stub = NULL;
         frame->referrablesSet = NULL;
         frame->referrableCount = 0;
+        frame->ownsReferrables = 0;
         frame->captures = NULL;;
         matte_string_clear(frame->prettyName);     
         frame->valueStack.size = 0;
@@ -422,9 +454,58 @@ static void vm_pop_frame(matteVM_t * vm) {
 }
 
 
+// Bytecode registered for a file but not yet decoded.
+typedef struct {
+    const uint8_t * bytecode;
+    uint32_t size;
+    // whether the bytecode is a copy owned by the VM.
+    int owned;
+} matteVMPendingBytecode_t;
+
+static void vm_add_bytecode(matteVM_t * vm, uint32_t fileid, const uint8_t * bytecode, uint32_t size, int copy) {
+    matteVMPendingBytecode_t * pending = (matteVMPendingBytecode_t*)matte_allocate(sizeof(matteVMPendingBytecode_t));
+    if (copy) {
+        uint8_t * data = (uint8_t*)matte_allocate(size);
+        memcpy(data, bytecode, size);
+        pending->bytecode = data;
+    } else {
+        pending->bytecode = bytecode;
+    }
+    pending->size = size;
+    pending->owned = copy;
+    matte_table_insert_by_uint(vm->pendingBytecode, fileid, pending);
+}
+
+static void vm_pending_bytecode_destroy(matteVMPendingBytecode_t * pending) {
+    if (pending->owned)
+        matte_deallocate((void*)pending->bytecode);
+    matte_deallocate(pending);
+}
+
+// Decodes the stubs of a file registered with vm_add_bytecode, if any.
+static matteTable_t * vm_decode_pending(matteVM_t * vm, uint32_t fileid) {
+    matteVMPendingBytecode_t * pending = (matteVMPendingBytecode_t*)matte_table_find_by_uint(vm->pendingBytecode, fileid);
+    if (!pending) return NULL;
+    matte_table_remove_by_uint(vm->pendingBytecode, fileid);
+
+    matteArray_t * stubs = matte_bytecode_stubs_from_bytecode(
+        vm->store,
+        fileid,
+        pending->bytecode,
+        pending->size
+    );        
+    matte_vm_add_stubs(vm, stubs);
+    matte_array_destroy(stubs);
+    vm_pending_bytecode_destroy(pending);
+    return (matteTable_t*)matte_table_find_by_uint(vm->stubIndex, fileid);
+}
+
 static matteBytecodeStub_t * vm_find_stub(matteVM_t * vm, uint32_t fileid, uint32_t stubid) {
     matteTable_t * subt = (matteTable_t*)matte_table_find_by_uint(vm->stubIndex, fileid);
-    if (!subt) return NULL;
+    if (!subt) {
+        subt = vm_decode_pending(vm, fileid);
+        if (!subt) return NULL;
+    }
     return (matteBytecodeStub_t*)matte_table_find_by_uint(subt, stubid);
 }
 
@@ -580,7 +661,6 @@ static matteValue_t vm_operator_1(matteVM_t * vm, matteOperator_t op, matteValue
 
 
 
-/*
 static const char * opcode_to_str(int oc) {
     switch(oc) {
       case MATTE_OPCODE_NOP: return "NOP";
@@ -591,9 +671,8 @@ static const char * opcode_to_str(int oc) {
       case MATTE_OPCODE_NST: return "NST";
       case MATTE_OPCODE_NOB: return "NOB";
       case MATTE_OPCODE_NFN: return "NFN";
-      case MATTE_OPCODE_NAR: return "NAR";
-      case MATTE_OPCODE_NSO: return "NSO";
-        
+      case MATTE_OPCODE_CAS: return "CAS";
+      case MATTE_OPCODE_CAA: return "CAA";
       case MATTE_OPCODE_CAL: return "CAL";
       case MATTE_OPCODE_ARF: return "ARF";
       case MATTE_OPCODE_OSN: return "OSN";
@@ -606,15 +685,44 @@ static const char * opcode_to_str(int oc) {
       case MATTE_OPCODE_SKP: return "SKP";
       case MATTE_OPCODE_ASP: return "ASP";
       case MATTE_OPCODE_PNR: return "PNR";
+      case MATTE_OPCODE_LST: return "LST";
+      case MATTE_OPCODE_PTO: return "PTO";
       case MATTE_OPCODE_SFS: return "SFS";
+      case MATTE_OPCODE_QRY: return "QRY";
       case MATTE_OPCODE_SCA: return "SCA";
       case MATTE_OPCODE_SCO: return "SCO";
+      case MATTE_OPCODE_SPA: return "SPA";
+      case MATTE_OPCODE_SPO: return "SPO";
+      case MATTE_OPCODE_OAS: return "OAS";
+      case MATTE_OPCODE_LOP: return "LOP";
+      case MATTE_OPCODE_FVR: return "FVR";
+      case MATTE_OPCODE_FCH: return "FCH";
+      case MATTE_OPCODE_CLV: return "CLV";
+      case MATTE_OPCODE_NEF: return "NEF";
+      case MATTE_OPCODE_PIP: return "PIP";
+      case MATTE_OPCODE_RSL: return "RSL";
+      case MATTE_OPCODE_RNO: return "RNO";
+      case MATTE_OPCODE_OAR: return "OAR";
+      case MATTE_OPCODE_CPP: return "CPP";
+      case MATTE_OPCODE_ARP: return "ARP";
+      case MATTE_OPCODE_ROP: return "ROP";
+      case MATTE_OPCODE_RLK: return "RLK";
+      case MATTE_OPCODE_RAS: return "RAS";
+      case MATTE_OPCODE_NAD: return "NAD";
+      case MATTE_OPCODE_NSB: return "NSB";
+      case MATTE_OPCODE_NML: return "NML";
+      case MATTE_OPCODE_NDV: return "NDV";
+      case MATTE_OPCODE_NLT: return "NLT";
+      case MATTE_OPCODE_NGT: return "NGT";
+      case MATTE_OPCODE_NLE: return "NLE";
+      case MATTE_OPCODE_NGE: return "NGE";
+      case MATTE_OPCODE_NEQ: return "NEQ";
+      case MATTE_OPCODE_NNE: return "NNE";
 
       default:
         return "???";
     }
 }
-*/
 
 
 static void vs_realloc(matteVMStackFrame_t * frame) {
@@ -644,9 +752,303 @@ static void vs_realloc(matteVMStackFrame_t * frame) {
 
 #define CONTROL_CODE_VALUE_TYPE__DYNAMIC_BINDING 0xff
 
+// Number-only operator opcodes. Numbers need no recycling, so 
+// the operands are dropped from the stack directly.
+#define VM_NUMBER_OPERATOR(__OPCODE__, __INTO__, __EXPR__) \
+          case __OPCODE__: {\
+            if (STACK_SIZE() >= 2 &&\
+                matte_value_type(STACK_PEEK(0)) == MATTE_VALUE_TYPE_NUMBER &&\
+                matte_value_type(STACK_PEEK(1)) == MATTE_VALUE_TYPE_NUMBER) {\
+                double a = matte_value_get_number(STACK_PEEK(1));\
+                double b = matte_value_get_number(STACK_PEEK(0));\
+                matteValue_t v = {};\
+                __INTO__(vm->store, &v, __EXPR__);\
+                frame->valueStack.size -= 2;\
+                STACK_PUSH(v);\
+            } else {\
+                vm_execute_opr(vm, frame, inst->data);\
+            }\
+            break;\
+          }
+
+// Operator and referrable assignment are shared between their
+// opcodes and the superinstructions that contain them.
+static void vm_execute_opr(matteVM_t * vm, matteVMStackFrame_t * frame, double data) {
+    switch((int)data) {
+        case MATTE_OPERATOR_ADD:
+        case MATTE_OPERATOR_SUB:
+        case MATTE_OPERATOR_DIV:
+        case MATTE_OPERATOR_MULT:
+        case MATTE_OPERATOR_BITWISE_OR:
+        case MATTE_OPERATOR_OR:
+        case MATTE_OPERATOR_BITWISE_AND:
+        case MATTE_OPERATOR_AND:
+        case MATTE_OPERATOR_SHIFT_LEFT:
+        case MATTE_OPERATOR_SHIFT_RIGHT:
+        case MATTE_OPERATOR_POW:
+        case MATTE_OPERATOR_EQ:
+        case MATTE_OPERATOR_POINT:
+        case MATTE_OPERATOR_TERNARY:
+        case MATTE_OPERATOR_GREATER:
+        case MATTE_OPERATOR_LESS:
+        case MATTE_OPERATOR_GREATEREQ:
+        case MATTE_OPERATOR_LESSEQ:
+        case MATTE_OPERATOR_TRANSFORM:
+        case MATTE_OPERATOR_MODULO:
+        case MATTE_OPERATOR_CARET:
+        case MATTE_OPERATOR_TYPESPEC:
+        case MATTE_OPERATOR_NOTEQ: {
+            if (STACK_SIZE() < 2) {
+                matte_vm_raise_error_cstring(vm, "OPR operator requires 2 operands.");                        
+            } else {
+                matteValue_t a = STACK_PEEK(1);
+                matteValue_t b = STACK_PEEK(0);
+                matteValue_t v = vm_operator_2(
+                    vm,
+                    (matteOperator_t)data,
+                    a, b
+                );
+                STACK_POP_NORET();
+                STACK_POP_NORET();
+                STACK_PUSH(v); // ok
+            }
+            break;                
+        }
+            
+        
+        case MATTE_OPERATOR_NOT:
+        case MATTE_OPERATOR_NEGATE:
+        case MATTE_OPERATOR_BITWISE_NOT:
+        case MATTE_OPERATOR_POUND:{
+            if (STACK_SIZE() < 1) {
+                matte_vm_raise_error_cstring(vm, "OPR operator requires 1 operand.");                        
+            } else {
+            
+                matteValue_t a = STACK_PEEK(0);
+                matteValue_t v = vm_operator_1(
+                    vm,
+                    (matteOperator_t)data,
+                    a
+                );
+                STACK_POP_NORET();
+                STACK_PUSH(v);
+            }
+            break;                
+        }
+    }
+}
+
+// Applies an assignment operator to a referrable, returning 
+// the new value.
+static matteValue_t vm_assign_referrable(matteVM_t * vm, matteValue_t * ref, uint32_t refn, uint64_t op, matteValue_t v) {
+    matteValue_t vOut;
+    switch(op + (int)MATTE_OPERATOR_ASSIGNMENT_NONE) {
+      case MATTE_OPERATOR_ASSIGNMENT_NONE: {
+        matte_vm_stackframe_set_referrable(vm, 0, refn, v);
+        vOut = matte_store_new_value(vm->store);
+        matte_value_into_copy(vm->store, &vOut, v);
+        break;
+      }
+        
+      case MATTE_OPERATOR_ASSIGNMENT_ADD: vOut = vm_operator__assign_add(vm, ref, v); break;
+      case MATTE_OPERATOR_ASSIGNMENT_SUB: vOut = vm_operator__assign_sub(vm, ref, v); break;
+      case MATTE_OPERATOR_ASSIGNMENT_MULT: vOut = vm_operator__assign_mult(vm, ref, v); break;
+      case MATTE_OPERATOR_ASSIGNMENT_DIV: vOut = vm_operator__assign_div(vm, ref, v); break;
+      case MATTE_OPERATOR_ASSIGNMENT_MOD: vOut = vm_operator__assign_mod(vm, ref, v); break;
+      case MATTE_OPERATOR_ASSIGNMENT_POW: vOut = vm_operator__assign_pow(vm, ref, v); break;
+      case MATTE_OPERATOR_ASSIGNMENT_AND: vOut = vm_operator__assign_and(vm, ref, v); break;
+      case MATTE_OPERATOR_ASSIGNMENT_OR: vOut = vm_operator__assign_or(vm, ref, v); break;
+      case MATTE_OPERATOR_ASSIGNMENT_XOR: vOut = vm_operator__assign_xor(vm, ref, v); break;
+      case MATTE_OPERATOR_ASSIGNMENT_BLEFT: vOut = vm_operator__assign_bleft(vm, ref, v); break;
+      case MATTE_OPERATOR_ASSIGNMENT_BRIGHT: vOut = vm_operator__assign_bright(vm, ref, v); break;
+      default:
+        vOut = matte_store_new_value(vm->store);
+        matte_vm_raise_error_cstring(vm, "VM error: tried to access non-existent referrable operation (corrupt bytecode?).");                        
+
+    }
+    return vOut;
+}
+
+static void vm_execute_arf(matteVM_t * vm, matteVMStackFrame_t * frame, double data) {
+    if (STACK_SIZE() < 1) {
+        matte_vm_raise_error_cstring(vm, "VM error: tried to prepare arguments for referrable assignment, but insufficient arguments on the stack.");    
+        return;
+    }
+    uint64_t refn = ((uint64_t)data) % 0xffffffff;
+    uint64_t op  = ((uint64_t)data) / 0xffffffff;
+    
+    matteValue_t * ref = (matteValue_t *)matte_vm_current_stackframe_get_referrable(vm, refn); 
+    if (ref) {
+        matteValue_t vOut = vm_assign_referrable(vm, ref, refn, op, STACK_PEEK(0));
+        STACK_POP_NORET();
+        STACK_PUSH(vOut); // new value is pushed
+    } else {
+        matte_vm_raise_error_cstring(vm, "VM error: tried to access non-existent referrable.");    
+    }
+}
+
+// Fetches a register-form slot of the current frame, or NULL 
+// if the slot is neither a referrable nor a capture.
+static matteValue_t * vm_register_slot(matteVM_t * vm, uint32_t slot) {
+    uint32_t captureCount;
+    if (slot < vm->top->referrableCount)
+        return (matteValue_t *)vm->top->referrablesSet+slot;
+    matte_bytecode_stub_get_captures(vm->top->stub, &captureCount);
+    if (slot - vm->top->referrableCount >= captureCount)
+        return NULL;
+    return (matteValue_t *)vm->top->captures[slot - vm->top->referrableCount];
+}
+
+// Fetches a register-form operand: either a referrable or 
+// a small integer written into imm.
+static matteValue_t * vm_register_operand(matteVM_t * vm, uint16_t slot, int isImmediate, matteValue_t * imm) {
+    if (isImmediate) {
+        matte_value_into_number(vm->store, imm, (int16_t)slot);
+        return imm;
+    }
+    return vm_register_slot(vm, slot);
+}
+
+
 static int vm_execution_loop__stack_depth = 0;
 #define VM_EXECUTABLE_LOOP_STACK_DEPTH_LIMIT 1024
 #define VM_EXECUTABLE_LOOP_CURRENT_LINE (matte_bytecode_stub_get_starting_line(frame->stub) + inst->info.lineOffset)
+// Whether a foreach can run every iteration in a single frame 
+// that is rebound between items, like for and forever loops.
+// Only plain arrays qualify, as other objects can run code 
+// (accessors, the foreach attribute) while being iterated. The 
+// function cannot be typestrict, as its arguments are checked 
+// once per call, and its referrables cannot be captured, as each 
+// iteration needs its own.
+static int vm_foreach_can_reuse_frame(matteVM_t * vm, matteValue_t a, matteValue_t b) {
+    if (matte_value_is_callable(vm->store, b) != 1) return 0;
+    if (!matte_value_object_is_plain_array(vm->store, a)) return 0;
+
+    matteBytecodeStub_t * stub = matte_value_get_bytecode_stub(vm->store, b);
+    if (!stub || matte_bytecode_stub_get_file_id(stub) == 0) return 0;
+
+    uint32_t instCount;
+    matte_bytecode_stub_get_instructions(stub, &instCount);
+    return 
+        instCount &&
+        matte_bytecode_stub_arg_count(stub) == 2 &&
+        !matte_bytecode_stub_is_vararg(stub) &&
+        !matte_bytecode_stub_referrables_captured(stub);
+}
+
+// Runs a foreach over a plain array within one frame. The values 
+// are copied and locked first so that, just like the general path,
+// changes to the array during iteration do not change what is visited.
+static void vm_foreach_array(matteVM_t * vm, matteValue_t a, matteValue_t b) {
+    matteStore_t * store = vm->store;
+    uint32_t count = matte_value_object_get_number_key_count(store, a);
+    if (!count) return;
+
+    matteBytecodeStub_t * stub = matte_value_get_bytecode_stub(store, b);
+    ForeachLoopData d = {
+        (matteValue_t*)matte_allocate(sizeof(matteValue_t)*count),
+        count,
+        0,
+        matte_bytecode_stub_local_count(stub)
+    };
+    memcpy(d.values, matte_value_object_array_at_unsafe(store, a, 0), sizeof(matteValue_t)*count);
+    
+    uint32_t i;
+    for(i = 0; i < count; ++i) {
+        matte_value_object_push_lock(store, d.values[i]);
+    }
+
+    matteValue_t args[2] = {
+        matte_store_new_value(store),
+        d.values[0]
+    };
+    matte_value_into_number(store, &args[0], 0);
+    matteValue_t argNames[2] = {
+        matte_bytecode_stub_get_arg_name_noref(stub, 0),
+        matte_bytecode_stub_get_arg_name_noref(stub, 1)
+    };
+    matteArray_t arr = MATTE_ARRAY_CAST(args, matteValue_t, 2);
+    matteArray_t arrNames = MATTE_ARRAY_CAST(argNames, matteValue_t, 2);
+
+    vm->pendingRestartCondition = vm_ext_call__foreach_restart_condition;
+    vm->pendingRestartConditionData = &d;
+    matte_store_recycle(store, matte_vm_call(vm, b, &arr, &arrNames, NULL));
+
+    // the loop was left early by an error or message.
+    for(i = d.i; i < count; ++i) {
+        matte_value_object_pop_lock(store, d.values[i]);
+    }
+    matte_deallocate(d.values);
+}
+
+// Calls a function once for each number key of an object, as the 
+// functional built-ins (map, filter, etc.) do, with the item bound as 
+// "value" and, if requested, the running result as "previous".
+// When possible, every call runs in one frame where only those 
+// arguments are rebound between items.
+static void vm_array_callback_run(matteVM_t * vm, matteValue_t fn, vmArrayCallback_t * d) {
+    d->i = 0;
+    if (!d->count) return;
+
+    matteValue_t names[2] = {
+        vm->specialString_value,
+        vm->specialString_previous
+    };
+    matteValue_t args[2];
+    matteArray_t arr = MATTE_ARRAY_CAST(args, matteValue_t, d->usesPrevious ? 2 : 1);
+    matteArray_t arrNames = MATTE_ARRAY_CAST(names, matteValue_t, d->usesPrevious ? 2 : 1);
+
+    int reuse = 0;
+    matteBytecodeStub_t * stub = matte_value_get_bytecode_stub(vm->store, fn);
+    if (matte_value_is_callable(vm->store, fn) == 1 && stub && matte_bytecode_stub_get_file_id(stub) != 0) {
+        uint32_t instCount;
+        matte_bytecode_stub_get_instructions(stub, &instCount);
+        if (instCount && !matte_bytecode_stub_is_vararg(stub) && !matte_bytecode_stub_referrables_captured(stub)) {
+            // names that cannot be bound are left to the normal 
+            // call path, which reports them.
+            uint32_t n;
+            uint32_t argCount = matte_bytecode_stub_arg_count(stub);
+            int foundValue = 0;
+            int foundPrevious = !d->usesPrevious;
+            for(n = 0; n < argCount; ++n) {
+                uint32_t id = matte_bytecode_stub_get_arg_name_noref(stub, n).value.id;
+                if (id == names[0].value.id) {
+                    d->valueSlot = n;
+                    foundValue = 1;
+                } else if (d->usesPrevious && id == names[1].value.id) {
+                    d->previousSlot = n;
+                    foundPrevious = 1;
+                }
+            }
+            d->referrableCount = argCount + matte_bytecode_stub_local_count(stub);
+            reuse = foundValue && foundPrevious;
+        }
+    }
+
+    if (reuse) {
+        d->value = vm_array_callback_get_value(vm, d);
+        if (vm->pendingCatchable) return;
+        args[0] = d->value;
+        args[1] = d->previous;
+        vm->pendingRestartCondition = vm_ext_call__array_callback_restart_condition;
+        vm->pendingRestartConditionData = d;
+        matte_store_recycle(vm->store, matte_vm_call(vm, fn, &arr, &arrNames, NULL));
+        return;
+    }
+
+    for(; d->i < d->count; ++d->i) {
+        if (vm->pendingCatchable) break;
+        d->value = matte_value_object_access_index(vm->store, d->array, d->i);
+        if (vm->pendingCatchable) break;
+        args[0] = d->value;
+        args[1] = d->previous;
+        matteValue_t result = matte_vm_call(vm, fn, &arr, &arrNames, NULL);
+        int more = !vm->pendingCatchable && d->onResult(vm, d, result);
+        matte_store_recycle(vm->store, result);
+        if (!more) break;
+    }
+}
+
 static matteValue_t vm_execution_loop(matteVM_t * vm) {
     vm_execution_loop__stack_depth ++;
     
@@ -677,6 +1079,10 @@ static matteValue_t vm_execution_loop(matteVM_t * vm) {
             printf("from %s, line %d, CALLSTACK%6d PC%6d, OPCODE %s, Stacklen: %10d\n", str ? matte_string_get_c_str(str) : "???", VM_EXECUTABLE_LOOP_CURRENT_LINE, vm->stacksize, frame->pc, opcode_to_str(inst->info.opcode), matte_array_get_size(frame->valueStack));
             fflush(stdout);
         #endif
+        if (vm->opcodePairs) {
+            vm->opcodePairs[vm->opcodeLast * 256 + inst->info.opcode]++;
+            vm->opcodeLast = inst->info.opcode;
+        }
         if (vm->debug) {
             if (vm->lastLine != VM_EXECUTABLE_LOOP_CURRENT_LINE) {
                 matteValue_t db = matte_store_new_value(vm->store);
@@ -909,13 +1315,31 @@ static matteValue_t vm_execution_loop(matteVM_t * vm) {
             uint32_t len = matte_value_object_get_number_key_count(vm->store, p);
             uint32_t i;
             uint32_t keylen = matte_value_object_get_number_key_count(vm->store, target);
-            for(i = 0; i < len; ++i) {
-                matte_value_object_insert(
-                    vm->store,
-                    target, 
-                    keylen++,
-                    matte_value_object_access_index(vm->store, p, i)
-                );
+            if (keylen == 0 && 
+                matte_value_object_is_plain_array(vm->store, p) &&
+                matte_value_object_share_into(vm->store, target, p)) {
+                // copied on write
+            } else if (matte_value_object_is_plain_array(vm->store, p) &&
+                matte_value_object_is_plain_array(vm->store, target)) {
+                // nothing can run while copying, so values are read in place
+                matte_value_object_array_set_size_unsafe(vm->store, target, keylen + len);
+                for(i = 0; i < len; ++i) {
+                    matte_value_object_set_index_unsafe(
+                        vm->store,
+                        target,
+                        keylen++,
+                        *matte_value_object_array_at_unsafe(vm->store, p, i)
+                    );
+                }
+            } else {
+                for(i = 0; i < len; ++i) {
+                    matte_value_object_insert(
+                        vm->store,
+                        target, 
+                        keylen++,
+                        matte_value_object_access_index(vm->store, p, i)
+                    );
+                }
             }
             
             STACK_POP();
@@ -931,6 +1355,11 @@ static matteValue_t vm_execution_loop(matteVM_t * vm) {
             }
              
             matteValue_t p = STACK_PEEK(0);
+            if (matte_value_object_spread_into(vm->store, STACK_PEEK(1), p)) {
+                STACK_POP();
+                matte_store_recycle(vm->store, p);
+                break;            
+            }
             matteValue_t keys = matte_value_object_keys(vm->store, p);
             matte_value_object_push_lock(vm->store, keys);
             matteValue_t vals = matte_value_object_values(vm->store, p);
@@ -1104,46 +1533,7 @@ static matteValue_t vm_execution_loop(matteVM_t * vm) {
             break;
           }
           case MATTE_OPCODE_ARF: {            
-            if (STACK_SIZE() < 1) {
-                matte_vm_raise_error_cstring(vm, "VM error: tried to prepare arguments for referrable assignment, but insufficient arguments on the stack.");    
-                break;            
-            }
-            uint64_t refn = ((uint64_t)inst->data) % 0xffffffff;
-            uint64_t op  = ((uint64_t)inst->data) / 0xffffffff;
-            
-            matteValue_t * ref = (matteValue_t *)matte_vm_current_stackframe_get_referrable(vm, refn); 
-            if (ref) {
-                matteValue_t v = STACK_PEEK(0);
-                matteValue_t vOut;
-                switch(op + (int)MATTE_OPERATOR_ASSIGNMENT_NONE) {
-                  case MATTE_OPERATOR_ASSIGNMENT_NONE: {
-                    matte_vm_stackframe_set_referrable(vm, 0, refn, v);
-                    vOut = matte_store_new_value(vm->store);
-                    matte_value_into_copy(vm->store, &vOut, v);
-                    break;
-                  }
-                    
-                  case MATTE_OPERATOR_ASSIGNMENT_ADD: vOut = vm_operator__assign_add(vm, ref, v); break;
-                  case MATTE_OPERATOR_ASSIGNMENT_SUB: vOut = vm_operator__assign_sub(vm, ref, v); break;
-                  case MATTE_OPERATOR_ASSIGNMENT_MULT: vOut = vm_operator__assign_mult(vm, ref, v); break;
-                  case MATTE_OPERATOR_ASSIGNMENT_DIV: vOut = vm_operator__assign_div(vm, ref, v); break;
-                  case MATTE_OPERATOR_ASSIGNMENT_MOD: vOut = vm_operator__assign_mod(vm, ref, v); break;
-                  case MATTE_OPERATOR_ASSIGNMENT_POW: vOut = vm_operator__assign_pow(vm, ref, v); break;
-                  case MATTE_OPERATOR_ASSIGNMENT_AND: vOut = vm_operator__assign_and(vm, ref, v); break;
-                  case MATTE_OPERATOR_ASSIGNMENT_OR: vOut = vm_operator__assign_or(vm, ref, v); break;
-                  case MATTE_OPERATOR_ASSIGNMENT_XOR: vOut = vm_operator__assign_xor(vm, ref, v); break;
-                  case MATTE_OPERATOR_ASSIGNMENT_BLEFT: vOut = vm_operator__assign_bleft(vm, ref, v); break;
-                  case MATTE_OPERATOR_ASSIGNMENT_BRIGHT: vOut = vm_operator__assign_bright(vm, ref, v); break;
-                  default:
-                    vOut = matte_store_new_value(vm->store);
-                    matte_vm_raise_error_cstring(vm, "VM error: tried to access non-existent referrable operation (corrupt bytecode?).");                        
-
-                }                
-                STACK_POP_NORET();
-                STACK_PUSH(vOut); // new value is pushed
-            } else {
-                matte_vm_raise_error_cstring(vm, "VM error: tried to access non-existent referrable.");    
-            }
+            vm_execute_arf(vm, frame, inst->data);
             break;
           }          
           case MATTE_OPCODE_POP: {
@@ -1338,10 +1728,13 @@ static matteValue_t vm_execution_loop(matteVM_t * vm) {
                 return matte_store_new_value(vm->store);
             }
 
-
             matte_value_object_push_lock(vm->store, a);
             matte_value_object_push_lock(vm->store, b);
-            matte_value_object_foreach(vm->store, a, b);
+            if (vm_foreach_can_reuse_frame(vm, a, b)) {
+                vm_foreach_array(vm, a, b);
+            } else {
+                matte_value_object_foreach(vm->store, a, b);
+            }
             matte_value_object_pop_lock(vm->store, a);
             matte_value_object_pop_lock(vm->store, b);
             STACK_POP_NORET();                    
@@ -1454,68 +1847,245 @@ static matteValue_t vm_execution_loop(matteVM_t * vm) {
           
           
           case MATTE_OPCODE_OPR: {            
-            switch((int)inst->data) {
-                case MATTE_OPERATOR_ADD:
-                case MATTE_OPERATOR_SUB:
-                case MATTE_OPERATOR_DIV:
-                case MATTE_OPERATOR_MULT:
-                case MATTE_OPERATOR_BITWISE_OR:
-                case MATTE_OPERATOR_OR:
-                case MATTE_OPERATOR_BITWISE_AND:
-                case MATTE_OPERATOR_AND:
-                case MATTE_OPERATOR_SHIFT_LEFT:
-                case MATTE_OPERATOR_SHIFT_RIGHT:
-                case MATTE_OPERATOR_POW:
-                case MATTE_OPERATOR_EQ:
-                case MATTE_OPERATOR_POINT:
-                case MATTE_OPERATOR_TERNARY:
-                case MATTE_OPERATOR_GREATER:
-                case MATTE_OPERATOR_LESS:
-                case MATTE_OPERATOR_GREATEREQ:
-                case MATTE_OPERATOR_LESSEQ:
-                case MATTE_OPERATOR_TRANSFORM:
-                case MATTE_OPERATOR_MODULO:
-                case MATTE_OPERATOR_CARET:
-                case MATTE_OPERATOR_TYPESPEC:
-                case MATTE_OPERATOR_NOTEQ: {
-                    if (STACK_SIZE() < 2) {
-                        matte_vm_raise_error_cstring(vm, "OPR operator requires 2 operands.");                        
-                    } else {
-                        matteValue_t a = STACK_PEEK(1);
-                        matteValue_t b = STACK_PEEK(0);
-                        matteValue_t v = vm_operator_2(
-                            vm,
-                            (matteOperator_t)(inst->data),
-                            a, b
-                        );
-                        STACK_POP_NORET();
-                        STACK_POP_NORET();
-                        STACK_PUSH(v); // ok
-                    }
-                    break;                
-                }
-                    
-                
-                case MATTE_OPERATOR_NOT:
-                case MATTE_OPERATOR_NEGATE:
-                case MATTE_OPERATOR_BITWISE_NOT:
-                case MATTE_OPERATOR_POUND:{
-                    if (STACK_SIZE() < 1) {
-                        matte_vm_raise_error_cstring(vm, "OPR operator requires 1 operand.");                        
-                    } else {
-                    
-                        matteValue_t a = STACK_PEEK(0);
-                        matteValue_t v = vm_operator_1(
-                            vm,
-                            (matteOperator_t)inst->data,
-                            a
-                        );
-                        STACK_POP_NORET();
-                        STACK_PUSH(v);
-                    }
-                    break;                
+            vm_execute_opr(vm, frame, inst->data);
+            break;
+          }
+
+
+          // superinstructions: the instructions that make up the 
+          // rest of the sequence directly follow.
+          case MATTE_OPCODE_RSL: {
+            if (frame->pc + 2 > instCount) {
+                matte_vm_raise_error_cstring(vm, "RSL opcode is missing its sequence (corrupt bytecode?)");
+                break;
+            }
+            matteValue_t * ref = (matteValue_t *)matte_vm_current_stackframe_get_referrable(vm, (uint32_t)inst->data);
+            if (!ref) {
+                matte_vm_raise_error_cstring(vm, "VM Error: Tried to push non-existant referrable.");
+                break;
+            }
+            matteValue_t key = matte_bytecode_stub_get_string_noref(frame->stub, (uint32_t)inst[1].data);
+            if (!matte_value_type(key)) {
+                matte_vm_raise_error_cstring(vm, "NST opcode refers to non-existent string (corrupt bytecode?)");
+                break;
+            }
+            
+            // the object stays on the stack during the access, as it would with PRF
+            matteValue_t object = matte_store_new_value(vm->store);
+            matte_value_into_copy(vm->store, &object, *ref);
+            STACK_PUSH(object);
+            matteValue_Extended_t ve = {};
+            ve.value = matte_value_object_access(vm->store, object, key, (uint32_t)inst[2].data);
+            STACK_POP_NORET();
+
+            if (matte_value_is_function(ve.value) && matte_value_type(object) == MATTE_VALUE_TYPE_OBJECT) {
+                ve.aux = object.value.id;
+            }        
+            STACK_PUSH_EXTENDED(ve);
+            frame->pc += 2;
+            break;
+          }
+          
+          case MATTE_OPCODE_RNO: {
+            if (frame->pc + 2 > instCount) {
+                matte_vm_raise_error_cstring(vm, "RNO opcode is missing its sequence (corrupt bytecode?)");
+                break;
+            }
+            matteValue_t * ref = (matteValue_t *)matte_vm_current_stackframe_get_referrable(vm, (uint32_t)inst->data);
+            if (!ref) {
+                matte_vm_raise_error_cstring(vm, "VM Error: Tried to push non-existant referrable.");
+                break;
+            }
+            matteValue_t b = {};
+            matte_value_into_number(vm->store, &b, inst[1].data);
+            
+            // numbers need no stack traffic. Anything else 
+            // may run user code, so it goes through the stack.
+            if (matte_value_type(*ref) == MATTE_VALUE_TYPE_NUMBER) {
+                matteValue_t v = vm_operator_2(
+                    vm,
+                    (matteOperator_t)inst[2].data,
+                    *ref, b
+                );
+                STACK_PUSH(v);
+            } else {
+                matteValue_t copy = matte_store_new_value(vm->store);
+                matte_value_into_copy(vm->store, &copy, *ref);
+                STACK_PUSH(copy);
+                STACK_PUSH(b);
+                vm_execute_opr(vm, frame, inst[2].data);
+            }
+            frame->pc += 2;
+            break;
+          }
+
+          case MATTE_OPCODE_OAR: {
+            if (frame->pc + 1 > instCount) {
+                matte_vm_raise_error_cstring(vm, "OAR opcode is missing its sequence (corrupt bytecode?)");
+                break;
+            }
+            vm_execute_opr(vm, frame, inst->data);
+            if (vm->pendingCatchable) break;
+            vm_execute_arf(vm, frame, inst[1].data);
+            frame->pc += 1;
+            break;
+          }
+
+          case MATTE_OPCODE_CPP: {
+            if (frame->pc + 1 > instCount) {
+                matte_vm_raise_error_cstring(vm, "CPP opcode is missing its sequence (corrupt bytecode?)");
+                break;
+            }
+            if (!STACK_SIZE()) {
+                matte_vm_raise_error_cstring(vm, "VM error: cannot CPY with empty stack");    
+                break;
+            }       
+            uint32_t popCount = (uint32_t)inst[1].data;
+            if (popCount == 0) {
+                matteValue_t cpy = matte_store_new_value(vm->store);
+                matte_value_into_copy(vm->store, &cpy, STACK_PEEK(0));
+                STACK_PUSH(cpy);
+            } else {
+                // the copy would be the first to go.
+                popCount--;
+                while (popCount && STACK_SIZE()) {
+                    matteValue_t m = STACK_POP();
+                    matte_store_recycle(vm->store, m);
+                    popCount--;
                 }
             }
+            frame->pc += 1;
+            break;
+          }
+
+          VM_NUMBER_OPERATOR(MATTE_OPCODE_NAD, matte_value_into_number, a + b)
+          VM_NUMBER_OPERATOR(MATTE_OPCODE_NSB, matte_value_into_number, a - b)
+          VM_NUMBER_OPERATOR(MATTE_OPCODE_NML, matte_value_into_number, a * b)
+          VM_NUMBER_OPERATOR(MATTE_OPCODE_NDV, matte_value_into_number, a / b)
+          VM_NUMBER_OPERATOR(MATTE_OPCODE_NLT, matte_value_into_boolean, a < b)
+          VM_NUMBER_OPERATOR(MATTE_OPCODE_NGT, matte_value_into_boolean, a > b)
+          VM_NUMBER_OPERATOR(MATTE_OPCODE_NLE, matte_value_into_boolean, a <= b)
+          VM_NUMBER_OPERATOR(MATTE_OPCODE_NGE, matte_value_into_boolean, a >= b)
+          VM_NUMBER_OPERATOR(MATTE_OPCODE_NEQ, matte_value_into_boolean, a == b)
+          VM_NUMBER_OPERATOR(MATTE_OPCODE_NNE, matte_value_into_boolean, a != b)
+
+          // register form
+          case MATTE_OPCODE_ROP: {
+            uint16_t ctl = inst->args.slot0;
+            matteValue_t immA = {};
+            matteValue_t immB = {};
+            matteValue_t * a = vm_register_operand(vm, inst->args.slot2, ctl & 0x100, &immA);
+            matteValue_t * b = vm_register_operand(vm, inst->args.slot3, ctl & 0x200, &immB);
+            if (!a || !b) {
+                matte_vm_raise_error_cstring(vm, "VM Error: Tried to push non-existant referrable.");
+                break;
+            }
+            if (!vm_register_slot(vm, inst->args.slot1)) {
+                matte_vm_raise_error_cstring(vm, "VM error: tried to access non-existent referrable.");    
+                break;
+            }
+            
+            matteValue_t v;
+            if (matte_value_type(*a) != MATTE_VALUE_TYPE_OBJECT && 
+                matte_value_type(*b) != MATTE_VALUE_TYPE_OBJECT) {
+                v = vm_operator_2(vm, (matteOperator_t)(ctl & 0xff), *a, *b);
+            } else {
+                // operators on objects can run user code, so the 
+                // operands are kept on the stack as they would be normally.
+                matteValue_t copy = matte_store_new_value(vm->store);
+                matte_value_into_copy(vm->store, &copy, *a);
+                STACK_PUSH(copy);
+                copy = matte_store_new_value(vm->store);
+                matte_value_into_copy(vm->store, &copy, *b);
+                STACK_PUSH(copy);
+                vm_execute_opr(vm, frame, ctl & 0xff);
+                if (vm->pendingCatchable) break;
+                v = STACK_POP();
+            }
+            if (!vm->pendingCatchable)
+                matte_vm_stackframe_set_referrable(vm, 0, inst->args.slot1, v);
+            matte_store_recycle(vm->store, v);
+            break;
+          }
+
+          case MATTE_OPCODE_RLK: {
+            matteValue_t * ref = vm_register_slot(vm, inst->args.slot2);
+            if (!ref) {
+                matte_vm_raise_error_cstring(vm, "VM Error: Tried to push non-existant referrable.");
+                break;
+            }
+            matteValue_t key = matte_bytecode_stub_get_string_noref(frame->stub, inst->args.slot3);
+            if (!matte_value_type(key)) {
+                matte_vm_raise_error_cstring(vm, "NST opcode refers to non-existent string (corrupt bytecode?)");
+                break;
+            }
+            if (!vm_register_slot(vm, inst->args.slot1)) {
+                matte_vm_raise_error_cstring(vm, "VM error: tried to access non-existent referrable.");    
+                break;
+            }
+
+            // the object stays on the stack during the access, as it would with PRF
+            matteValue_t object = matte_store_new_value(vm->store);
+            matte_value_into_copy(vm->store, &object, *ref);
+            STACK_PUSH(object);
+            matteValue_t v = matte_value_object_access(vm->store, object, key, inst->args.slot0);
+            STACK_POP_NORET();
+            
+            if (!vm->pendingCatchable)
+                matte_vm_stackframe_set_referrable(vm, 0, inst->args.slot1, v);
+            matte_store_recycle(vm->store, v);
+            break;
+          }
+
+          case MATTE_OPCODE_RAS: {
+            uint16_t ctl = inst->args.slot0;
+            matteValue_t imm = {};
+            matteValue_t * a = vm_register_operand(vm, inst->args.slot2, ctl & 0x100, &imm);
+            if (!a) {
+                matte_vm_raise_error_cstring(vm, "VM Error: Tried to push non-existant referrable.");
+                break;
+            }
+            matteValue_t * ref = vm_register_slot(vm, inst->args.slot1);
+            if (!ref) {
+                matte_vm_raise_error_cstring(vm, "VM error: tried to access non-existent referrable.");    
+                break;
+            }
+
+            if ((ctl & 0xff) == 0) {
+                matte_vm_stackframe_set_referrable(vm, 0, inst->args.slot1, *a);
+                break;
+            }
+
+            matteValue_t vOut;
+            if (matte_value_type(*a) != MATTE_VALUE_TYPE_OBJECT && 
+                matte_value_type(*ref) != MATTE_VALUE_TYPE_OBJECT) {
+                vOut = vm_assign_referrable(vm, ref, inst->args.slot1, ctl & 0xff, *a);
+            } else {
+                // see ROP
+                matteValue_t copy = matte_store_new_value(vm->store);
+                matte_value_into_copy(vm->store, &copy, *a);
+                STACK_PUSH(copy);
+                vOut = vm_assign_referrable(vm, ref, inst->args.slot1, ctl & 0xff, copy);
+                STACK_POP_NORET();
+            }
+            matte_store_recycle(vm->store, vOut);
+            break;
+          }
+
+          case MATTE_OPCODE_ARP: {
+            if (frame->pc + 1 > instCount) {
+                matte_vm_raise_error_cstring(vm, "ARP opcode is missing its sequence (corrupt bytecode?)");
+                break;
+            }
+            vm_execute_arf(vm, frame, inst->data);
+            if (vm->pendingCatchable) break;
+            uint32_t popCount = (uint32_t)inst[1].data;
+            while (popCount && STACK_SIZE()) {
+                matteValue_t m = STACK_POP();
+                matte_store_recycle(vm->store, m);
+                popCount--;
+            }
+            frame->pc += 1;
             break;
           }
       
@@ -1645,6 +2215,7 @@ matteVM_t * matte_vm_create(matte_t * m) {
 
     vm->callstack = matte_array_create(sizeof(matteVMStackFrame_t *));
     vm->stubIndex = matte_table_create_hash_pointer();
+    vm->pendingBytecode = matte_table_create_hash_pointer();
     vm->interruptOps = matte_array_create(sizeof(matteBytecodeStubInstruction_t));
     vm->externalFunctions = matte_table_create_hash_matte_string();
     vm->externalFunctionIndex = matte_array_create(sizeof(ExternalFunctionSet_t));
@@ -1657,6 +2228,11 @@ matteVM_t * matte_vm_create(matte_t * m) {
     vm->imported = matte_table_create_hash_pointer();
     vm->nextID = 1;
     vm->cleanupFunctionSets = matte_array_create(sizeof(MatteCleanupFunctionSet));
+    vm->formatCache = matte_table_create_hash_pointer();
+    vm->formatItems = matte_array_create(sizeof(matteString_t *));
+    vm->formatOutput = matte_string_create();
+    // workers started in the same second still get their own sequences.
+    matte_vm_set_random_seed(vm, (uint64_t)time(NULL) ^ (uint64_t)(uintptr_t)vm);
     
     vm->specialString_from = matte_store_new_value(vm->store);
     matte_value_into_string(vm->store, &vm->specialString_from, MATTE_VM_STR_CAST(vm, "from"));
@@ -1757,7 +2333,9 @@ matteVM_t * matte_vm_create(matte_t * m) {
     const matteString_t * comparator = MATTE_VM_STR_CAST(vm, "comparator");
     const matteString_t * sort_names[] = {
         query_name,
-        comparator
+        comparator,
+        MATTE_VM_STR_CAST(vm, "by"),
+        MATTE_VM_STR_CAST(vm, "descending")
     };
     
     const matteString_t * functional_names[] = {
@@ -1868,6 +2446,7 @@ matteVM_t * matte_vm_create(matte_t * m) {
     temp = *emptyArr;                                   vm_add_built_in(vm, MATTE_EXT_CALL__NUMBER__PI,        &temp, vm_ext_call__number__pi);    
     temp = MATTE_ARRAY_CAST(&stringName, matteString_t *, 1);vm_add_built_in(vm, MATTE_EXT_CALL__NUMBER__PARSE,     &temp, vm_ext_call__number__parse);    
     temp = *emptyArr;                                   vm_add_built_in(vm, MATTE_EXT_CALL__NUMBER__RANDOM,    &temp, vm_ext_call__number__random);    
+    temp = MATTE_ARRAY_CAST(&value, matteString_t *, 1);vm_add_built_in(vm, MATTE_EXT_CALL__NUMBER__SEED,    &temp, vm_ext_call__number__seed);    
 
 
     // STRING
@@ -1881,6 +2460,7 @@ matteVM_t * matte_vm_create(matte_t * m) {
     temp = *emptyArr;                                   vm_add_built_in(vm, MATTE_EXT_CALL__OBJECT__FREEZEGC,    &temp, vm_ext_call__object__freeze_gc);    
     temp = *emptyArr;                                   vm_add_built_in(vm, MATTE_EXT_CALL__OBJECT__THAWGC,    &temp, vm_ext_call__object__thaw_gc);    
     temp = *emptyArr;                                   vm_add_built_in(vm, MATTE_EXT_CALL__OBJECT__GARBAGECOLLECT,    &temp, vm_ext_call__object__garbage_collect);    
+    temp = MATTE_ARRAY_CAST(&value, matteString_t *, 1);vm_add_built_in(vm, MATTE_EXT_CALL__OBJECT__FREEZE,    &temp, vm_ext_call__object__freeze);    
 
     
     
@@ -1897,7 +2477,7 @@ matteVM_t * matte_vm_create(matte_t * m) {
     temp = MATTE_ARRAY_CAST(insert_names, matteString_t *, 3);   vm_add_built_in(vm, MATTE_EXT_CALL__QUERY__INSERT,     &temp, vm_ext_call__object__insert);    
     temp = MATTE_ARRAY_CAST(removeKey_names, matteString_t *, 2);   vm_add_built_in(vm, MATTE_EXT_CALL__QUERY__REMOVE,     &temp, vm_ext_call__object__remove);    
     temp = MATTE_ARRAY_CAST(setAttributes_names, matteString_t *, 2);   vm_add_built_in(vm, MATTE_EXT_CALL__QUERY__SETATTRIBUTES,     &temp, vm_ext_call__object__set_attributes);    
-    temp = MATTE_ARRAY_CAST(sort_names, matteString_t *, 2);   vm_add_built_in(vm, MATTE_EXT_CALL__QUERY__SORT,     &temp, vm_ext_call__object__sort);    
+    temp = MATTE_ARRAY_CAST(sort_names, matteString_t *, 4);   vm_add_built_in(vm, MATTE_EXT_CALL__QUERY__SORT,     &temp, vm_ext_call__object__sort);    
     temp = MATTE_ARRAY_CAST(subset_names, matteString_t *, 3);   vm_add_built_in(vm, MATTE_EXT_CALL__QUERY__SUBSET,     &temp, vm_ext_call__object__subset);    
     temp = MATTE_ARRAY_CAST(filterNames, matteString_t *, 2);   vm_add_built_in(vm, MATTE_EXT_CALL__QUERY__FILTER,     &temp, vm_ext_call__object__filter);    
     temp = MATTE_ARRAY_CAST(findIndex_names, matteString_t *, 2);   vm_add_built_in(vm, MATTE_EXT_CALL__QUERY__FINDINDEX,     &temp, vm_ext_call__object__findindex);    
@@ -1956,15 +2536,9 @@ matteVM_t * matte_vm_create(matte_t * m) {
 
             uint32_t fileid = matte_vm_get_new_file_id(vm, name);
             
-            matteArray_t * stubs = matte_bytecode_stubs_from_bytecode(
-                vm->store,
-                fileid,
-                src,
-                srcLen
-            );        
+            // decoded when first imported.
+            vm_add_bytecode(vm, fileid, src, srcLen, 0);
             matte_string_destroy(name);    
-            matte_vm_add_stubs(vm, stubs);
-            matte_array_destroy(stubs);
         }
     }
     #endif
@@ -2007,6 +2581,12 @@ void matte_vm_destroy(matteVM_t * vm) {
     len = matte_array_get_size(vm->extFuncs);
     matte_array_destroy(vm->extFuncs);
 
+    vm_format_cache_clear(vm);
+    matte_table_destroy(vm->formatCache);
+    matte_array_destroy(vm->formatItems);
+    matte_string_destroy(vm->formatOutput);
+    matte_deallocate(vm->opcodePairs);
+
 
 
     matte_table_destroy(vm->imported);
@@ -2031,6 +2611,13 @@ void matte_vm_destroy(matteVM_t * vm) {
     }
     matte_table_destroy(vm->stubIndex);
 
+    for(matte_table_iter_start(iter, vm->pendingBytecode);
+        !matte_table_iter_is_end(iter);
+        matte_table_iter_proceed(iter)) {
+        vm_pending_bytecode_destroy((matteVMPendingBytecode_t*)matte_table_iter_get_value(iter));
+    }
+    matte_table_destroy(vm->pendingBytecode);
+
 
 
 
@@ -2110,6 +2697,10 @@ void matte_vm_add_stubs(matteVM_t * vm, const matteArray_t * arr) {
     }
 }
 
+void matte_vm_add_bytecode(matteVM_t * vm, uint32_t fileid, const uint8_t * bytecode, uint32_t size) {
+    vm_add_bytecode(vm, fileid, bytecode, size, 1);
+}
+
 matteStore_t * matte_vm_get_store(matteVM_t * vm) {return vm->store;}
 
 
@@ -2481,12 +3072,30 @@ matteValue_t matte_vm_call_full(
         frame->context = d;
         frame->stub = stub;
 
-        // ref copies of values happen here.
-        frame->captures = matte_value_object_function_activate_closure(
-            vm->store, 
-            frame->context, 
-            referrables // xfer ownership
-        );
+        if (matte_bytecode_stub_referrables_captured(stub)) {
+            // ref copies of values happen here.
+            frame->captures = matte_value_object_function_activate_closure(
+                vm->store, 
+                frame->context, 
+                referrables // xfer ownership
+            );
+        } else {
+            // nothing can refer to the referrables once the call is done,
+            // so the frame keeps them.
+            frame->captures = matte_value_object_function_activate_closure_detached(
+                vm->store, 
+                frame->context, 
+                referrables
+            );
+            frame->ownsReferrables = 1;
+            for(i = 0; i < refCount; ++i) {
+                // arguments are borrowed from the caller, so the frame 
+                // takes its own reference as the closure would. Both are 
+                // released when the call returns.
+                matte_value_into_copy(vm->store, referrables+i, referrables[i]);
+                matte_value_object_push_lock(vm->store, referrables[i]);
+            }
+        }
         frame->referrablesSet = referrables;
 
         #ifdef MATTE_DEBUG__STORE
@@ -2537,6 +3146,15 @@ matteValue_t matte_vm_call_full(
             }
         };
 
+        if (frame->ownsReferrables) {
+            matte_value_object_function_deactivate_closure(vm->store, frame->context);
+            for(i = 0; i < refCount; ++i) {
+                matte_value_object_pop_lock(vm->store, referrables[i]);
+                matte_store_recycle(vm->store, referrables[i]);
+            }
+            matte_deallocate(referrables);
+            frame->ownsReferrables = 0;
+        }
         matte_value_object_pop_lock(vm->store, frame->context);
 
         // cleanup;
@@ -3026,7 +3644,15 @@ void matte_vm_stackframe_set_referrable(matteVM_t * vm, uint32_t i, uint32_t ref
 
 
     // get context
-    if (referrableID < frames[i]->referrableCount) {
+    if (referrableID < frames[i]->referrableCount && frames[i]->ownsReferrables) {
+        matteValue_t * ref = (matteValue_t *)frames[i]->referrablesSet + referrableID;
+        matteValue_t vNew = matte_store_new_value(vm->store);
+        matte_value_into_copy(vm->store, &vNew, val);
+        matte_value_object_push_lock(vm->store, vNew);
+        matte_value_object_pop_lock(vm->store, *ref);
+        matte_store_recycle(vm->store, *ref);
+        *ref = vNew;
+    } else if (referrableID < frames[i]->referrableCount) {
         matte_value_object_function_set_closure_value_unsafe(vm->store, frames[i]->context, referrableID, val);
     } else {
         matte_value_set_captured_value(vm->store, 
@@ -3133,6 +3759,100 @@ void matte_vm_set_debug_callback(
     vm->debugData = data;
 }
 
+void matte_vm_enable_opcode_profile(matteVM_t * vm, int enabled) {
+    matte_deallocate(vm->opcodePairs);
+    vm->opcodePairs = NULL;
+    vm->opcodeLast = MATTE_OPCODE_NOP;
+    if (enabled)
+        vm->opcodePairs = (uint64_t*)matte_allocate(256 * 256 * sizeof(uint64_t));
+}
+
+// Expands a seed into generator state, as recommended for xoshiro.
+static uint64_t vm_random_splitmix(uint64_t * x) {
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static inline uint64_t vm_random_rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+// xoshiro256**
+static inline uint64_t vm_random_next(uint64_t * s) {
+    uint64_t result = vm_random_rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = vm_random_rotl(s[3], 45);
+    return result;
+}
+
+// top 53 bits as a double within [0, 1)
+#define VM_RANDOM_TO_DOUBLE(__R__) (((__R__) >> 11) * (1.0 / 9007199254740992.0))
+
+void matte_vm_set_random_seed(matteVM_t * vm, uint64_t seed) {
+    int i;
+    for(i = 0; i < 4; ++i) 
+        vm->randomState[i] = vm_random_splitmix(&seed);
+}
+
+double matte_vm_get_random(matteVM_t * vm) {
+    return VM_RANDOM_TO_DOUBLE(vm_random_next(vm->randomState));
+}
+
+void matte_vm_fill_random(matteVM_t * vm, double * out, uint32_t count) {
+    uint64_t s[4];
+    memcpy(s, vm->randomState, sizeof(s));
+    uint32_t i;
+    for(i = 0; i < count; ++i)
+        out[i] = VM_RANDOM_TO_DOUBLE(vm_random_next(s));
+    memcpy(vm->randomState, s, sizeof(s));
+}
+
+matteString_t * matte_vm_opcode_profile_report(matteVM_t * vm, uint32_t max) {
+    matteString_t * out = matte_string_create();
+    if (!vm->opcodePairs) return out;
+
+    uint64_t total = 0;
+    uint32_t i;
+    for(i = 0; i < 256 * 256; ++i) {
+        total += vm->opcodePairs[i];
+    }
+    if (!total) return out;
+
+    // repeatedly picks the next most frequent pair; 
+    // the table is small and reports are rare.
+    uint8_t * reported = (uint8_t*)matte_allocate(256 * 256);
+    uint32_t n;
+    for(n = 0; n < max; ++n) {
+        uint32_t best = 0;
+        uint64_t bestCount = 0;
+        for(i = 0; i < 256 * 256; ++i) {
+            if (!reported[i] && vm->opcodePairs[i] > bestCount) {
+                best = i;
+                bestCount = vm->opcodePairs[i];
+            }
+        }
+        if (!bestCount) break;
+        reported[best] = 1;
+        matte_string_concat_printf(
+            out, 
+            "%s %s %12llu %6.2f%%\n", 
+            opcode_to_str(best / 256), 
+            opcode_to_str(best % 256), 
+            (unsigned long long)bestCount, 
+            100.0 * bestCount / (double)total
+        );
+    }
+    matte_deallocate(reported);
+    return out;
+}
+
 void matte_vm_set_unhandled_callback(
     matteVM_t * vm,
     void(*cb)(matteVM_t *, uint32_t file, int lineNumber, matteValue_t, void *),
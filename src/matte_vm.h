@@ -113,6 +113,24 @@ matteStore_t * matte_vm_get_store(matteVM_t *);
 /// Ownership of the stubs is transferred (but not the array)
 void matte_vm_add_stubs(matteVM_t *, const matteArray_t *);
 
+/// Registers bytecode for the given file without decoding it.
+/// The stubs are decoded the first time the file is run or 
+/// one of its functions is looked up, so files that are never 
+/// imported cost only a copy of their bytecode.
+void matte_vm_add_bytecode(
+    /// The VM to add to.
+    matteVM_t *, 
+    
+    /// The fileID the stubs will belong to.
+    uint32_t fileID,
+    
+    /// The bytecode. It is copied.
+    const uint8_t * bytecode,
+    
+    /// The size of the bytecode in bytes.
+    uint32_t size
+);
+
 /// Sets the implementation for the import function.
 void matte_vm_set_import(
     matteVM_t * vm,
@@ -300,7 +318,14 @@ struct matteVMStackFrame_t {
 
     /// Copy of the referrable list owned by the context function 
     /// Is available for quick access, but is owned by the context function
+    /// unless ownsReferrables is set.
     const matteValue_t * referrablesSet;
+    
+    /// Whether referrablesSet is owned by the stackframe itself. This is 
+    /// the case for functions whose referrables are never captured:
+    /// objects within are kept alive with locks instead of being linked 
+    /// to the context function.
+    int ownsReferrables;
 
     
     const matteValue_t ** captures;
@@ -393,6 +418,30 @@ void matte_vm_set_debug_callback(
     void(*)(matteVM_t *, matteVMDebugEvent_t event, uint32_t file, int lineNumber, matteValue_t value, void *),
     void *
 );
+/// Enables or disables counting of each pair of consecutive 
+/// opcodes as they are executed. Either way, existing counts 
+/// are cleared. Off by default.
+void matte_vm_enable_opcode_profile(matteVM_t * vm, int enabled);
+
+/// Returns a new string listing the most frequently executed 
+/// opcode pairs since profiling was enabled, one pair per line 
+/// with its count and share of all pairs. At most max lines 
+/// are included.
+matteString_t * matte_vm_opcode_profile_report(matteVM_t * vm, uint32_t max);
+
+/// Seeds the VM's random number generator, which backs Number.random.
+/// The same seed always gives the same sequence. Each VM is seeded 
+/// differently when created.
+void matte_vm_set_random_seed(matteVM_t * vm, uint64_t seed);
+
+/// Returns the next number from the VM's random number generator, 
+/// within [0, 1).
+double matte_vm_get_random(matteVM_t * vm);
+
+/// Writes the next count numbers from the VM's random number 
+/// generator into out, as matte_vm_get_random() would return them.
+void matte_vm_fill_random(matteVM_t * vm, double * out, uint32_t count);
+
 /// Sets a handler for unhandled errors. Unhandled errors are fatal to the VM.
 void matte_vm_set_unhandled_callback(
     matteVM_t * vm,
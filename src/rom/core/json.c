@@ -36,6 +36,7 @@ DEALINGS IN THE SOFTWARE.
 #include <stdio.h>
 #include "../../matte_string.h"
 #include "../../matte_table.h"
+#include "../../matte_number.h"
 
 static uint32_t utf8_next_char(uint8_t ** source) {
     uint8_t * iter = *source;
@@ -91,16 +92,12 @@ static void push_cstr_buffer_cleaned(matteArray_t * buffer, const char * str) {
 
 
 static void push_double_buffer(matteArray_t * buffer, double val) {
-    static char tempstr[128];
-    
-    if (fabs(val - (int64_t)val) < DBL_EPSILON) {
-        sprintf(tempstr, "%" PRId64 "", (int64_t)val);
-    } else if (isnan(val)) {
-        sprintf(tempstr, "null");
-    } else {
-        sprintf(tempstr, "%.15g", val);        
+    if (isnan(val)) {
+        push_cstr_buffer(buffer, "null");
+        return;
     }
-    
+    char tempstr[MATTE_NUMBER_C_STR_MAX];
+    matte_number_value_to_c_str(val, tempstr);
     push_cstr_buffer(buffer, tempstr);
 }
 
@@ -414,7 +411,8 @@ matteValue_t decode_value(matteVM_t * vm, matteStore_t * store, StringIter * ite
         }
         
         const matteString_t * numstr = matte_string_get_substr(iter->str, start, start+count-1);
-        double num = strtod(matte_string_get_c_str(numstr), NULL);
+        double num = 0;
+        matte_number_from_c_str(matte_string_get_c_str(numstr), &num);
         matte_value_into_number(store, &out, num);
         iter->index += matte_string_get_length(numstr);
         break;
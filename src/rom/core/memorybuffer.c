@@ -1,6 +1,7 @@
 #include <stdint.h>
 #include <stddef.h>
 #include <string.h>
+#include <math.h>
 
 #include "../native.h"
 #include "../../matte.h"
@@ -119,12 +120,14 @@ MATTE_EXT_FN(matte_ext__memory_buffer__set_size) {
         uint64_t oldLength = m->alloc;
         m->alloc = length;
         uint8_t * newBuffer = (uint8_t*)matte_allocate(length);
-        memcpy(newBuffer, m->buffer, oldLength);
+        if (m->buffer)
+            memcpy(newBuffer, m->buffer, oldLength);
         matte_deallocate(m->buffer);
         m->buffer = newBuffer;
     }
     // no such thing as uninitialized
-    memset(m->buffer+m->size, 0, length - m->size);    
+    if (length > m->size)
+        memset(m->buffer+m->size, 0, length - m->size);    
     m->size = length;
     return matte_store_new_value(store);
 }
@@ -464,6 +467,426 @@ MATTE_EXT_FN(matte_ext__memory_buffer__write_primitive) {
 
 
 
+// Typed views read and write a buffer's bytes as packed numbers. 
+// The element kinds use the same codes as read/write_primitive.
+#define MEMORYBUFFER_TYPED__INT32   2
+#define MEMORYBUFFER_TYPED__FLOAT64 9
+
+// Fetches the buffer and element kind for a typed operation.
+// Raises an error and returns NULL if either is invalid.
+static MatteMemoryBuffer * memory_buffer_typed_get(matteVM_t * vm, matteValue_t a, matteValue_t k, int * kind, uint64_t * count) {
+    matteStore_t * store = matte_vm_get_store(vm);
+    MatteMemoryBuffer * m = (MatteMemoryBuffer*)matte_value_object_get_userdata(store, a);
+    if (!(m && m->idval == MEMORYBUFFER_ID_TAG)) {
+        matte_vm_raise_error_string(vm, MATTE_VM_STR_CAST(vm, "Typed array buffer is invalid or was released."));
+        return NULL;
+    }
+    *kind = matte_value_as_number(store, k);
+    switch(*kind) {
+      case MEMORYBUFFER_TYPED__INT32:   *count = m->size / sizeof(int32_t); break;
+      case MEMORYBUFFER_TYPED__FLOAT64: *count = m->size / sizeof(double); break;
+      default:
+        matte_vm_raise_error_string(vm, MATTE_VM_STR_CAST(vm, "Unknown typed array element kind."));
+        return NULL;
+    }
+    return m;
+}
+
+// Converts a number to an int32 element, wrapping like an unsigned 
+// 32-bit integer rather than relying on an out-of-range cast. 
+// NaN and infinities become 0.
+static int32_t memory_buffer_typed_to_int32(double v) {
+    if (!isfinite(v)) return 0;
+    v = fmod(trunc(v), 4294967296.0);
+    if (v < 0) v += 4294967296.0;
+    return (int32_t)(uint32_t)v;
+}
+
+static matteValue_t memory_buffer_typed_number(matteStore_t * store, double v) {
+    matteValue_t out = matte_store_new_value(store);
+    matte_value_into_number(store, &out, v);
+    return out;
+}
+
+
+MATTE_EXT_FN(matte_ext__memory_buffer__typed_length) {
+    matteStore_t * store = matte_vm_get_store(vm);
+    int kind;
+    uint64_t count;
+    if (!memory_buffer_typed_get(vm, args[0], args[1], &kind, &count))
+        return matte_store_new_value(store);
+    return memory_buffer_typed_number(store, count);
+}
+
+MATTE_EXT_FN(matte_ext__memory_buffer__typed_get) {
+    matteStore_t * store = matte_vm_get_store(vm);
+    int kind;
+    uint64_t count;
+    MatteMemoryBuffer * m = memory_buffer_typed_get(vm, args[0], args[1], &kind, &count);
+    if (!m) return matte_store_new_value(store);
+
+    double index = matte_value_as_number(store, args[2]);
+    if (!(index >= 0 && index < count)) {
+        matte_vm_raise_error_string(vm, MATTE_VM_STR_CAST(vm, "Could not get value from typed array: index out of range."));
+        return matte_store_new_value(store);
+    }
+    uint64_t i = index;
+    if (kind == MEMORYBUFFER_TYPED__INT32)
+        return memory_buffer_typed_number(store, ((int32_t*)m->buffer)[i]);
+    return memory_buffer_typed_number(store, ((double*)m->buffer)[i]);
+}
+
+MATTE_EXT_FN(matte_ext__memory_buffer__typed_set) {
+    matteStore_t * store = matte_vm_get_store(vm);
+    int kind;
+    uint64_t count;
+    MatteMemoryBuffer * m = memory_buffer_typed_get(vm, args[0], args[1], &kind, &count);
+    if (!m) return matte_store_new_value(store);
+
+    double index = matte_value_as_number(store, args[2]);
+    double val = matte_value_as_number(store, args[3]);
+    if (!(index >= 0 && index < count)) {
+        matte_vm_raise_error_string(vm, MATTE_VM_STR_CAST(vm, "Could not set value in typed array: index out of range."));
+        return matte_store_new_value(store);
+    }
+    uint64_t i = index;
+    if (kind == MEMORYBUFFER_TYPED__INT32)
+        ((int32_t*)m->buffer)[i] = memory_buffer_typed_to_int32(val);
+    else
+        ((double*)m->buffer)[i] = val;
+    return matte_store_new_value(store);
+}
+
+
+// The bulk operations below are plain loops over restrict pointers 
+// so that the compiler can vectorize them for the target. Floating point 
+// reductions keep 4 independent partial sums to break the dependency 
+// chain without needing reassociation flags.
+MATTE_EXT_FN(matte_ext__memory_buffer__typed_sum) {
+    matteStore_t * store = matte_vm_get_store(vm);
+    int kind;
+    uint64_t count;
+    MatteMemoryBuffer * m = memory_buffer_typed_get(vm, args[0], args[1], &kind, &count);
+    if (!m) return matte_store_new_value(store);
+
+    uint64_t i;
+    if (kind == MEMORYBUFFER_TYPED__INT32) {
+        const int32_t * restrict src = (const int32_t*)m->buffer;
+        int64_t sum = 0;
+        for(i = 0; i < count; ++i)
+            sum += src[i];
+        return memory_buffer_typed_number(store, (double)sum);
+    }
+
+    const double * restrict src = (const double*)m->buffer;
+    double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    for(i = 0; i + 4 <= count; i += 4) {
+        s0 += src[i];
+        s1 += src[i+1];
+        s2 += src[i+2];
+        s3 += src[i+3];
+    }
+    for(; i < count; ++i)
+        s0 += src[i];
+    return memory_buffer_typed_number(store, (s0 + s1) + (s2 + s3));
+}
+
+// shared by min and max. Empty arrays have no extreme and return empty.
+static matteValue_t memory_buffer_typed_extreme(matteVM_t * vm, const matteValue_t * args, int max) {
+    matteStore_t * store = matte_vm_get_store(vm);
+    int kind;
+    uint64_t count;
+    MatteMemoryBuffer * m = memory_buffer_typed_get(vm, args[0], args[1], &kind, &count);
+    if (!m || count == 0) return matte_store_new_value(store);
+
+    uint64_t i;
+    if (kind == MEMORYBUFFER_TYPED__INT32) {
+        const int32_t * restrict src = (const int32_t*)m->buffer;
+        int32_t out = src[0];
+        if (max) {
+            for(i = 1; i < count; ++i)
+                out = src[i] > out ? src[i] : out;
+        } else {
+            for(i = 1; i < count; ++i)
+                out = src[i] < out ? src[i] : out;
+        }
+        return memory_buffer_typed_number(store, out);
+    }
+
+    const double * restrict src = (const double*)m->buffer;
+    double out = src[0];
+    if (max) {
+        for(i = 1; i < count; ++i)
+            out = src[i] > out ? src[i] : out;
+    } else {
+        for(i = 1; i < count; ++i)
+            out = src[i] < out ? src[i] : out;
+    }
+    return memory_buffer_typed_number(store, out);
+}
+
+MATTE_EXT_FN(matte_ext__memory_buffer__typed_min) {
+    return memory_buffer_typed_extreme(vm, args, 0);
+}
+
+MATTE_EXT_FN(matte_ext__memory_buffer__typed_max) {
+    return memory_buffer_typed_extreme(vm, args, 1);
+}
+
+MATTE_EXT_FN(matte_ext__memory_buffer__typed_dot) {
+    matteStore_t * store = matte_vm_get_store(vm);
+    int kind, kindB;
+    uint64_t count, countB;
+    MatteMemoryBuffer * a = memory_buffer_typed_get(vm, args[0], args[2], &kind,  &count);
+    if (!a) return matte_store_new_value(store);
+    MatteMemoryBuffer * b = memory_buffer_typed_get(vm, args[1], args[2], &kindB, &countB);
+    if (!b) return matte_store_new_value(store);
+    if (count != countB) {
+        matte_vm_raise_error_string(vm, MATTE_VM_STR_CAST(vm, "Dot product failed: typed arrays differ in length."));
+        return matte_store_new_value(store);
+    }
+
+    uint64_t i;
+    if (kind == MEMORYBUFFER_TYPED__INT32) {
+        const int32_t * srcA = (const int32_t*)a->buffer;
+        const int32_t * srcB = (const int32_t*)b->buffer;
+        int64_t sum = 0;
+        for(i = 0; i < count; ++i)
+            sum += (int64_t)srcA[i] * srcB[i];
+        return memory_buffer_typed_number(store, (double)sum);
+    }
+
+    const double * srcA = (const double*)a->buffer;
+    const double * srcB = (const double*)b->buffer;
+    double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    for(i = 0; i + 4 <= count; i += 4) {
+        s0 += srcA[i]   * srcB[i];
+        s1 += srcA[i+1] * srcB[i+1];
+        s2 += srcA[i+2] * srcB[i+2];
+        s3 += srcA[i+3] * srcB[i+3];
+    }
+    for(; i < count; ++i)
+        s0 += srcA[i] * srcB[i];
+    return memory_buffer_typed_number(store, (s0 + s1) + (s2 + s3));
+}
+
+MATTE_EXT_FN(matte_ext__memory_buffer__typed_scale) {
+    matteStore_t * store = matte_vm_get_store(vm);
+    int kind;
+    uint64_t count;
+    MatteMemoryBuffer * m = memory_buffer_typed_get(vm, args[0], args[1], &kind, &count);
+    if (!m) return matte_store_new_value(store);
+
+    double factor = matte_value_as_number(store, args[2]);
+    uint64_t i;
+    if (kind == MEMORYBUFFER_TYPED__INT32) {
+        int32_t * restrict dst = (int32_t*)m->buffer;
+        if (factor == trunc(factor) && factor >= INT32_MIN && factor <= INT32_MAX) {
+            // whole factors stay in integer math, wrapping on overflow.
+            uint32_t f = (uint32_t)(int32_t)factor;
+            for(i = 0; i < count; ++i)
+                dst[i] = (int32_t)((uint32_t)dst[i] * f);
+        } else {
+            for(i = 0; i < count; ++i)
+                dst[i] = memory_buffer_typed_to_int32(dst[i] * factor);
+        }
+        return matte_store_new_value(store);
+    }
+
+    double * restrict dst = (double*)m->buffer;
+    for(i = 0; i < count; ++i)
+        dst[i] *= factor;
+    return matte_store_new_value(store);
+}
+
+MATTE_EXT_FN(matte_ext__memory_buffer__typed_add) {
+    matteStore_t * store = matte_vm_get_store(vm);
+    int kind, kindB;
+    uint64_t count, countB;
+    MatteMemoryBuffer * a = memory_buffer_typed_get(vm, args[0], args[2], &kind,  &count);
+    if (!a) return matte_store_new_value(store);
+    MatteMemoryBuffer * b = memory_buffer_typed_get(vm, args[1], args[2], &kindB, &countB);
+    if (!b) return matte_store_new_value(store);
+    if (count != countB) {
+        matte_vm_raise_error_string(vm, MATTE_VM_STR_CAST(vm, "Add failed: typed arrays differ in length."));
+        return matte_store_new_value(store);
+    }
+
+    // a and b may be the same buffer, so no restrict here. 
+    // Each element only reads its own index, which still vectorizes.
+    uint64_t i;
+    if (kind == MEMORYBUFFER_TYPED__INT32) {
+        int32_t * dst = (int32_t*)a->buffer;
+        const int32_t * src = (const int32_t*)b->buffer;
+        for(i = 0; i < count; ++i)
+            dst[i] = (int32_t)((uint32_t)dst[i] + (uint32_t)src[i]);
+        return matte_store_new_value(store);
+    }
+
+    double * dst = (double*)a->buffer;
+    const double * src = (const double*)b->buffer;
+    for(i = 0; i < count; ++i)
+        dst[i] += src[i];
+    return matte_store_new_value(store);
+}
+
+MATTE_EXT_FN(matte_ext__memory_buffer__typed_fill) {
+    matteStore_t * store = matte_vm_get_store(vm);
+    int kind;
+    uint64_t count;
+    MatteMemoryBuffer * m = memory_buffer_typed_get(vm, args[0], args[1], &kind, &count);
+    if (!m) return matte_store_new_value(store);
+
+    double val = matte_value_as_number(store, args[2]);
+    uint64_t i;
+    if (kind == MEMORYBUFFER_TYPED__INT32) {
+        int32_t * restrict dst = (int32_t*)m->buffer;
+        int32_t v = memory_buffer_typed_to_int32(val);
+        for(i = 0; i < count; ++i)
+            dst[i] = v;
+        return matte_store_new_value(store);
+    }
+
+    double * restrict dst = (double*)m->buffer;
+    for(i = 0; i < count; ++i)
+        dst[i] = val;
+    return matte_store_new_value(store);
+}
+
+// Fills with numbers from the VM's generator, spread over [from, to).
+// int32 elements are rounded down.
+MATTE_EXT_FN(matte_ext__memory_buffer__typed_fill_random) {
+    matteStore_t * store = matte_vm_get_store(vm);
+    int kind;
+    uint64_t count;
+    MatteMemoryBuffer * m = memory_buffer_typed_get(vm, args[0], args[1], &kind, &count);
+    if (!m) return matte_store_new_value(store);
+
+    double from = matte_value_type(args[2]) ? matte_value_as_number(store, args[2]) : 0;
+    double to   = matte_value_type(args[3]) ? matte_value_as_number(store, args[3]) : 1;
+    double range = to - from;
+    uint64_t i;
+    if (kind == MEMORYBUFFER_TYPED__INT32) {
+        int32_t * restrict dst = (int32_t*)m->buffer;
+        double chunk[256];
+        while(count) {
+            uint32_t n = count < 256 ? (uint32_t)count : 256;
+            matte_vm_fill_random(vm, chunk, n);
+            for(i = 0; i < n; ++i)
+                dst[i] = memory_buffer_typed_to_int32(floor(from + chunk[i] * range));
+            dst += n;
+            count -= n;
+        }
+        return matte_store_new_value(store);
+    }
+
+    double * restrict dst = (double*)m->buffer;
+    while(count) {
+        uint32_t n = count < 0x100000 ? (uint32_t)count : 0x100000;
+        matte_vm_fill_random(vm, dst, n);
+        if (from != 0 || to != 1) {
+            for(i = 0; i < n; ++i)
+                dst[i] = from + dst[i] * range;
+        }
+        dst += n;
+        count -= n;
+    }
+    return matte_store_new_value(store);
+}
+
+MATTE_EXT_FN(matte_ext__memory_buffer__typed_copy) {
+    matteStore_t * store = matte_vm_get_store(vm);
+    int kind, kindB;
+    uint64_t count, countB;
+    MatteMemoryBuffer * a = memory_buffer_typed_get(vm, args[0], args[5], &kind,  &count);
+    if (!a) return matte_store_new_value(store);
+    MatteMemoryBuffer * b = memory_buffer_typed_get(vm, args[2], args[5], &kindB, &countB);
+    if (!b) return matte_store_new_value(store);
+
+    double offsetA = matte_value_as_number(store, args[1]);
+    double offsetB = matte_value_as_number(store, args[3]);
+    double length  = matte_value_as_number(store, args[4]);
+    if (!(offsetA >= 0 && offsetB >= 0 && length >= 0 &&
+          offsetA + length <= count &&
+          offsetB + length <= countB)) {
+        matte_vm_raise_error_string(vm, MATTE_VM_STR_CAST(vm, "Copy of typed array failed: The copy is outside the range of either the source or destination."));
+        return matte_store_new_value(store);
+    }
+
+    uint32_t size = kind == MEMORYBUFFER_TYPED__INT32 ? sizeof(int32_t) : sizeof(double);
+    // views of the same buffer can overlap.
+    memmove(
+        a->buffer + (uint64_t)offsetA*size, 
+        b->buffer + (uint64_t)offsetB*size, 
+        (uint64_t)length*size
+    );
+    return matte_store_new_value(store);
+}
+
+// Resizes the buffer to hold exactly the given array's values.
+MATTE_EXT_FN(matte_ext__memory_buffer__typed_from_array) {
+    matteStore_t * store = matte_vm_get_store(vm);
+    int kind;
+    uint64_t count;
+    MatteMemoryBuffer * m = memory_buffer_typed_get(vm, args[0], args[1], &kind, &count);
+    if (!m) return matte_store_new_value(store);
+
+    uint32_t len = matte_value_object_get_number_key_count(store, args[2]);
+    uint32_t size = kind == MEMORYBUFFER_TYPED__INT32 ? sizeof(int32_t) : sizeof(double);
+    uint64_t bytes = (uint64_t)len*size;
+    if (m->alloc < bytes) {
+        uint8_t * newBuffer = (uint8_t*)matte_allocate(bytes);
+        matte_deallocate(m->buffer);
+        m->buffer = newBuffer;
+        m->alloc = bytes;
+    }
+    m->size = bytes;
+
+    uint32_t i;
+    for(i = 0; i < len; ++i) {
+        matteValue_t v = matte_value_object_access_index(store, args[2], i);
+        if (matte_value_type(v) != MATTE_VALUE_TYPE_NUMBER) {
+            m->size = (uint64_t)i*size;
+            matte_vm_raise_error_string(vm, MATTE_VM_STR_CAST(vm, "Typed arrays can only be loaded from arrays of Numbers."));
+            return matte_store_new_value(store);
+        }
+        double d = matte_value_get_number(v);
+        if (kind == MEMORYBUFFER_TYPED__INT32)
+            ((int32_t*)m->buffer)[i] = memory_buffer_typed_to_int32(d);
+        else 
+            ((double*)m->buffer)[i] = d;
+    }
+    return matte_store_new_value(store);
+}
+
+MATTE_EXT_FN(matte_ext__memory_buffer__typed_to_array) {
+    matteStore_t * store = matte_vm_get_store(vm);
+    int kind;
+    uint64_t count;
+    MatteMemoryBuffer * m = memory_buffer_typed_get(vm, args[0], args[1], &kind, &count);
+    if (!m) return matte_store_new_value(store);
+
+    matteArray_t * arr = matte_array_create(sizeof(matteValue_t));
+    matte_array_set_size(arr, count);
+    uint64_t i;
+    for(i = 0; i < count; ++i) {
+        matte_array_at(arr, matteValue_t, i) = memory_buffer_typed_number(
+            store,
+            kind == MEMORYBUFFER_TYPED__INT32 ? 
+                ((int32_t*)m->buffer)[i] 
+            :
+                ((double*)m->buffer)[i]
+        );
+    }
+    matteValue_t out = matte_store_new_value(store);
+    matte_value_into_new_object_array_ref(store, &out, arr);
+    matte_array_destroy(arr);
+    return out;
+}
+
+
+
+
 
 
 
@@ -487,5 +910,20 @@ static void matte_system__memorybuffer(matteVM_t * vm) {
     matte_vm_set_external_function_autoname(vm, MATTE_VM_STR_CAST(vm, "__matte_::mbuffer_write_primitive"),4, matte_ext__memory_buffer__write_primitive,    NULL);
     matte_vm_set_external_function_autoname(vm, MATTE_VM_STR_CAST(vm, "__matte_::mbuffer_read_primitive"), 3, matte_ext__memory_buffer__read_primitive,    NULL);
 
+    matte_vm_set_external_function_autoname(vm, MATTE_VM_STR_CAST(vm, "__matte_::mbuffer_typed_length"),  2, matte_ext__memory_buffer__typed_length,    NULL);
+    matte_vm_set_external_function_autoname(vm, MATTE_VM_STR_CAST(vm, "__matte_::mbuffer_typed_get"),     3, matte_ext__memory_buffer__typed_get,       NULL);
+    matte_vm_set_external_function_autoname(vm, MATTE_VM_STR_CAST(vm, "__matte_::mbuffer_typed_set"),     4, matte_ext__memory_buffer__typed_set,       NULL);
+    matte_vm_set_external_function_autoname(vm, MATTE_VM_STR_CAST(vm, "__matte_::mbuffer_typed_sum"),     2, matte_ext__memory_buffer__typed_sum,       NULL);
+    matte_vm_set_external_function_autoname(vm, MATTE_VM_STR_CAST(vm, "__matte_::mbuffer_typed_min"),     2, matte_ext__memory_buffer__typed_min,       NULL);
+    matte_vm_set_external_function_autoname(vm, MATTE_VM_STR_CAST(vm, "__matte_::mbuffer_typed_max"),     2, matte_ext__memory_buffer__typed_max,       NULL);
+    matte_vm_set_external_function_autoname(vm, MATTE_VM_STR_CAST(vm, "__matte_::mbuffer_typed_dot"),     3, matte_ext__memory_buffer__typed_dot,       NULL);
+    matte_vm_set_external_function_autoname(vm, MATTE_VM_STR_CAST(vm, "__matte_::mbuffer_typed_scale"),   3, matte_ext__memory_buffer__typed_scale,     NULL);
+    matte_vm_set_external_function_autoname(vm, MATTE_VM_STR_CAST(vm, "__matte_::mbuffer_typed_add"),     3, matte_ext__memory_buffer__typed_add,       NULL);
+    matte_vm_set_external_function_autoname(vm, MATTE_VM_STR_CAST(vm, "__matte_::mbuffer_typed_fill"),    3, matte_ext__memory_buffer__typed_fill,      NULL);
+    matte_vm_set_external_function_autoname(vm, MATTE_VM_STR_CAST(vm, "__matte_::mbuffer_typed_fill_random"), 4, matte_ext__memory_buffer__typed_fill_random, NULL);
+    matte_vm_set_external_function_autoname(vm, MATTE_VM_STR_CAST(vm, "__matte_::mbuffer_typed_copy"),    6, matte_ext__memory_buffer__typed_copy,      NULL);
+    matte_vm_set_external_function_autoname(vm, MATTE_VM_STR_CAST(vm, "__matte_::mbuffer_typed_from_array"), 3, matte_ext__memory_buffer__typed_from_array, NULL);
+    matte_vm_set_external_function_autoname(vm, MATTE_VM_STR_CAST(vm, "__matte_::mbuffer_typed_to_array"),   2, matte_ext__memory_buffer__typed_to_array,   NULL);
+
  
 }
@@ -91,6 +91,7 @@ int main() {
         "core/eventsystem.mt",  "Matte.Core.EventSystem",
         "core/introspect.mt",   "Matte.Core.Introspect",
         "core/memorybuffer.mt", "Matte.Core.MemoryBuffer",
+        "core/typedarray.mt",   "Matte.Core.TypedArray",
         "core/core.mt",         "Matte.Core",
         #ifdef MATTE_USE_SYSTEM_EXTENSIONS
             "system/consoleio.mt",      "Matte.System.ConsoleIO",       
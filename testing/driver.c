@@ -33,6 +33,8 @@ DEALINGS IN THE SOFTWARE.
 #include "../src/matte_array.h"
 #include "../src/matte_string.h"
 #include "../src/matte_compiler.h"
+#include "../src/matte_store_string.h"
+#include "../src/matte_mvt2.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -129,8 +131,13 @@ static void test_string(matteVM_t * vm) {
     assert(matte_string_get_char(str, 4) == 'o');
     
     assert(matte_string_test_eq(str, MATTE_VM_STR_CAST(vm, "hello4world!!!")));
+    uint32_t hash = matte_string_get_hash(str);
+    assert(matte_string_get_utf8_length(str) == 14);
     matte_string_set_char(str, 4, 'O');
     matte_string_append_char(str, 'i');
+    assert(matte_string_get_hash(str) != hash);
+    assert(matte_string_get_utf8_length(str) == 15);
+    assert(!matte_string_test_eq(str, MATTE_VM_STR_CAST(vm, "hello4world!!!i")));
     assert(!matte_string_compare(str, MATTE_VM_STR_CAST(vm, "hellO4world!!!i")));
     assert(matte_string_test_contains(str, MATTE_VM_STR_CAST(vm, "4world")));
     assert(!matte_string_test_contains(str, MATTE_VM_STR_CAST(vm, "o4woild")));
@@ -162,7 +169,75 @@ static void test_string(matteVM_t * vm) {
 }
 
 
+static void test_string_store() {
+    matteStringStore_t * h = matte_string_store_create();
+    uint32_t id = matte_string_store_ref_cstring(h, "temporary");
+    assert(matte_string_store_ref_cstring(h, "temporary") == id);
+    matte_string_store_unref(h, id);
+    matte_string_store_unref(h, id);
+    
+    // unreferenced strings are kept for a while and revived on use
+    assert(matte_string_store_find(h, id));
+    assert(matte_string_store_ref_cstring(h, "temporary") == id);
+    matte_string_store_unref(h, id);
+
+    // ...until enough other strings go unused.
+    char name[32];
+    uint32_t i;
+    for(i = 0; i < 1000; ++i) {
+        sprintf(name, "other%d", i);
+        matte_string_store_unref(h, matte_string_store_ref_cstring(h, name));
+    }
+    const matteString_t * str = matte_string_store_find(h, id);
+    assert(!str || strcmp(matte_string_get_c_str(str), "temporary"));
+    matte_string_store_destroy(h);
+}
+
 
+static void test_mvt2_iter() {
+    matteMVT2_t * t = matte_mvt2_create();
+    matteValue_t key = {};
+    matteValue_t value = {};
+    key.binIDreserved = MATTE_VALUE_TYPE_STRING;
+    value.binIDreserved = MATTE_VALUE_TYPE_STRING;
+    uint32_t i;
+    for(i = 0; i < 100; ++i) {
+        key.value.id = i;
+        value.value.id = i * 2;
+        matte_mvt2_insert(t, key, value);
+    }
+    
+    // every pair is visited once, in place
+    matteMVT2Iter_t iter;
+    matteValue_t * found;
+    uint32_t count = 0;
+    uint32_t sum = 0;
+    matte_mvt2_iter_start(&iter, t);
+    while(matte_mvt2_iter_next(&iter, &key, &found)) {
+        assert(found->value.id == key.value.id * 2);
+        sum += key.value.id;
+        count++;
+        
+        // changing values does not invalidate
+        found->value.id = 0;
+        matte_mvt2_insert(t, key, *found);
+    }
+    assert(matte_mvt2_iter_is_valid(&iter));
+    assert(count == 100 && sum == 4950);
+    
+    // adding or removing keys does
+    matte_mvt2_iter_start(&iter, t);
+    assert(matte_mvt2_iter_next(&iter, &key, &found));
+    matte_mvt2_remove(t, key);
+    assert(!matte_mvt2_iter_is_valid(&iter));
+    assert(!matte_mvt2_iter_next(&iter, &key, &found));
+
+    matte_mvt2_iter_start(&iter, t);
+    key.value.id = 1000;
+    matte_mvt2_insert(t, key, value);
+    assert(!matte_mvt2_iter_next(&iter, &key, &found));
+    matte_mvt2_destroy(t);
+}
 
 static void onErrorCatch(
     matteVM_t * vm, 
@@ -265,6 +340,63 @@ static matteValue_t test_external_function(
 
 #include "../src/matte_pool.h"
 
+// Imports a module through the default importer with the 
+// bytecode cache in the given directory.
+static double test_bytecode_cache_import(const char * directory, const char * path) {
+    matte_t * m = matte_create();
+    matteVM_t * vm = matte_get_vm(m);
+    matte_set_importer(m, NULL, NULL);
+    matte_set_bytecode_cache(m, directory);
+    matteValue_t v = matte_vm_import(vm, MATTE_VM_STR_CAST(vm, path), NULL, 0, matte_store_new_value(matte_vm_get_store(vm)));
+    assert(matte_value_type(v) == MATTE_VALUE_TYPE_NUMBER);
+    double out = matte_value_as_number(matte_vm_get_store(vm), v);
+    matte_destroy(m);
+    return out;
+}
+
+static void test_bytecode_cache() {
+#ifdef P_tmpdir
+    const char * directory = P_tmpdir;
+    matteString_t * path = matte_string_create_from_c_str("%s/matte_cache_test.mt", directory);
+    const char * pathStr = matte_string_get_c_str(path);
+    const char * sourceA = "return 40 + 2;";
+    const char * sourceB = "return 40 + 3;";
+    
+    FILE * f = fopen(pathStr, "wb");
+    if (!f) return;
+    fputs(sourceA, f);
+    fclose(f);
+    
+    // miss, then stored.
+    assert(test_bytecode_cache_import(directory, pathStr) == 42);
+    matte_t * m = matte_create();
+    matte_set_bytecode_cache(m, directory);
+    uint32_t size;
+    uint8_t * bytecode = matte_bytecode_cache_get(m, pathStr, (const uint8_t*)sourceA, strlen(sourceA), &size);
+    assert(bytecode && size);
+    matte_deallocate(bytecode);
+    assert(!matte_bytecode_cache_get(m, pathStr, (const uint8_t*)sourceB, strlen(sourceB), &size));
+
+    // different compiler options are different entries
+    matte_compiler_enable_optimization(0);
+    assert(!matte_bytecode_cache_get(m, pathStr, (const uint8_t*)sourceA, strlen(sourceA), &size));
+    matte_compiler_enable_optimization(1);
+    matte_destroy(m);
+    
+    // hit
+    assert(test_bytecode_cache_import(directory, pathStr) == 42);
+    
+    // same size, changed just now: must not reuse the entry.
+    f = fopen(pathStr, "wb");
+    fputs(sourceB, f);
+    fclose(f);
+    assert(test_bytecode_cache_import(directory, pathStr) == 43);
+
+    remove(pathStr);
+    matte_string_destroy(path);
+#endif
+}
+
 int main() {
     /*
     {
@@ -307,9 +439,15 @@ int main() {
     matte_t * m = matte_create();
     test_string(matte_get_vm(m));
     test_string_utf8(matte_get_vm(m));
+    test_string_store();
+    test_mvt2_iter();
     matte_destroy(m);
     m = NULL;
+    test_bytecode_cache();
     
+    int firstTest = TESTID;
+    int sharedStrings = 0;
+
     matteString_t * infile = matte_string_create();
     matteString_t * outfile = matte_string_create();
 
@@ -326,7 +464,16 @@ int main() {
 
         uint32_t lenBytes;
         uint8_t * src = dump_bytes(matte_string_get_c_str(infile), &lenBytes);
-        if (!src) break;
+        if (!src) {
+            // the corpus runs a second time with the strings 
+            // loaded from bytecode shared across VMs.
+            if (sharedStrings) break;
+            sharedStrings = 1;
+            matte_enable_shared_strings();
+            TESTID = firstTest;
+            printf("Running tests again with shared strings...\n");
+            continue;
+        }
         
         char * srcstr = malloc(lenBytes+1);
         memcpy(srcstr, src, lenBytes);